@@ -0,0 +1,173 @@
+# Copyright (c) 2026 Chris Lee and contributors.
+# Licensed under the MIT license. See LICENSE file in the project root for details.
+
+"""Convert Dough133 trace log files (from /api/trace?file=N) to CSV."""
+
+# ruff: noqa: T201, INP001
+
+import argparse
+import csv
+import struct
+import sys
+from pathlib import Path
+
+HEADER = struct.Struct("<4sHHI20x")
+# TraceRecord: msec, type, arg, seq (reserved in version 1), then a 24-byte payload.
+RECORD = struct.Struct("<IBBH24s")
+# Payloads: a HistorySample, a TraceInput or a TraceCommand (see src/trace_log.h).
+SAMPLE = struct.Struct("<IhhhBBhhhhHBx")
+INPUT = struct.Struct("<ffffIHBB")
+COMMAND = struct.Struct("<fIIfB7x")
+BOOT, TICK, TRANSITION, INPUT_TYPE, COMMAND_TYPE, DOCUMENT = 1, 2, 3, 4, 5, 6
+RECORD_TYPES = {
+    BOOT: "boot",
+    TICK: "tick",
+    TRANSITION: "transition",
+    INPUT_TYPE: "input",
+    COMMAND_TYPE: "command",
+    DOCUMENT: "document",
+}
+COMMAND_NAMES = {
+    1: "enable",
+    2: "button",
+    3: "test_command",
+    4: "autotune",
+    5: "set_temp",
+    6: "fan_mode",
+    7: "program_start",
+    8: "program_stop",
+    9: "program_resume",
+    10: "program_skip",
+}
+DOCUMENT_NAMES = {0: "config", 1: "program"}
+DOCUMENT_LAST = 0x80
+STATE_NAMES = ["Off", "Running", "Cooling...", "Error!", "Test Command", "Autotune"]
+NAN16 = -32768
+COLUMNS = [
+    "file",
+    "msec",
+    "seq",
+    "type",
+    "arg",
+    "state",
+    "enclosure_temp",
+    "room_temp",
+    "target",
+    "enclosure_humidity",
+    "room_humidity",
+    "p",
+    "i",
+    "d",
+    "ff",
+    "heater",
+    "value",
+]
+
+
+def fixed(value: int, scale: float) -> float | str:
+    """Convert a fixed-point value, where the minimum int16 means no value."""
+    return "" if value == NAN16 else value / scale
+
+
+def sample_columns(rtype: int, arg: int, payload: bytes) -> list:
+    """Columns from arg for a boot, tick or transition record with a HistorySample."""
+    (_sec, enc, room, target, enc_rh, room_rh, p, i, d, ff, heater,
+     state) = SAMPLE.unpack(payload)  # fmt: skip
+    return [
+        STATE_NAMES[arg] if rtype == TRANSITION and arg < len(STATE_NAMES) else arg,
+        STATE_NAMES[state] if state < len(STATE_NAMES) else state,
+        fixed(enc, 100),
+        fixed(room, 100),
+        fixed(target, 100),
+        enc_rh / 2,
+        room_rh / 2,
+        fixed(p, 1e4),
+        fixed(i, 1e4),
+        fixed(d, 1e4),
+        fixed(ff, 1e4),
+        heater / 1e4,
+        "",
+    ]
+
+
+def input_columns(payload: bytes) -> list:
+    """Columns from arg for a TraceInput: arg is the tick periods, value the lateness."""
+    enc, room, enc_rh, room_rh, _sample_msec, late_msec, periods, flags = INPUT.unpack(payload)
+    return [
+        periods,
+        "",
+        enc if flags & 1 else "",
+        room if flags & 2 else "",
+        "",
+        enc_rh if flags & 1 else "",
+        room_rh if flags & 2 else "",
+        "",
+        "",
+        "",
+        "",
+        "",
+        late_msec,
+    ]
+
+
+def command_columns(arg: int, payload: bytes) -> list:
+    """Columns from arg for a TraceCommand: value is the command's value and param."""
+    value, param, _sample_msec, enc, enc_ok = COMMAND.unpack(payload)
+    return [
+        COMMAND_NAMES.get(arg, arg),
+        "",
+        enc if enc_ok else "",
+        *[""] * 9,
+        f"{value:g} {param}",
+    ]
+
+
+def decode(path: Path) -> list[list]:
+    """Decode one trace file into CSV rows.  A document becomes one row, at its last record."""
+    data = path.read_bytes()
+    if len(data) < HEADER.size:
+        return []
+    magic, version, record_size, _block_size = HEADER.unpack_from(data)
+    if magic != b"DTRC" or version not in (1, 2) or record_size != RECORD.size:
+        print(f"{path}: not a version 1 or 2 trace file", file=sys.stderr)
+        return []
+    rows = []
+    document = b""
+    for offset in range(HEADER.size, len(data) - RECORD.size + 1, RECORD.size):
+        msec, rtype, arg, seq, payload = RECORD.unpack_from(data, offset)
+        if rtype == INPUT_TYPE:
+            columns = input_columns(payload)
+        elif rtype == COMMAND_TYPE:
+            columns = command_columns(arg, payload)
+        elif rtype == DOCUMENT:
+            document += payload.rstrip(b"\0")
+            if not arg & DOCUMENT_LAST:
+                continue
+            kind = arg & ~DOCUMENT_LAST
+            columns = [DOCUMENT_NAMES.get(kind, kind), *[""] * 11, document.decode()]
+            document = b""
+        else:
+            columns = sample_columns(rtype, arg, payload)
+        rows.append([
+            path.name,
+            msec,
+            seq if version >= 2 else "",
+            RECORD_TYPES.get(rtype, rtype),
+            *columns,
+        ])
+    return rows
+
+
+def main() -> None:
+    """Command line interface."""
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("files", nargs="+", type=Path, help="trace files, oldest first")
+    args = parser.parse_args()
+    writer = csv.writer(sys.stdout)
+    writer.writerow(COLUMNS)
+    for path in args.files:
+        writer.writerows(decode(path))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,77 @@
+# Copyright (c) 2026 Chris Lee and contributors.
+# Licensed under the MIT license. See LICENSE file in the project root for details.
+
+"""Record a Dough133 trace longer than the device keeps, for replay in the simulator.
+
+Polls the two newest trace files on the device (/api/trace?file=N) and appends the records
+not seen yet to one trace file.  With traceInputs set the device's trace files hold less than
+an hour, so poll more often than that.  Start recording soon after the device restarts, so the
+file begins at the boot:
+
+    python3 record_trace.py dough133.local run.bin
+    .pio/build/native/program --replay run.bin --csv replay.csv
+"""
+
+# ruff: noqa: T201, INP001, S310
+
+import argparse
+import sys
+import time
+import urllib.error
+import urllib.request
+from pathlib import Path
+
+RECORD_SIZE = 32  # the file header has the same size as a record
+
+
+def fetch(host: str, idx: int) -> bytes:
+    """Download trace file idx (0 is the newest), or return nothing if there is none."""
+    try:
+        with urllib.request.urlopen(f"http://{host}/api/trace?file={idx}", timeout=30) as reply:
+            return reply.read()
+    except urllib.error.HTTPError as error:
+        if error.code == 404:  # noqa: PLR2004
+            return b""
+        raise
+
+
+def records(data: bytes) -> list[bytes]:
+    """Split a trace file into records, after its header."""
+    end = len(data) - len(data) % RECORD_SIZE
+    return [data[offset : offset + RECORD_SIZE] for offset in range(RECORD_SIZE, end, RECORD_SIZE)]
+
+
+def main() -> None:
+    """Command line interface."""
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("host", help="device host name or address")
+    parser.add_argument("out", type=Path, help="trace file to write, appended to if it exists")
+    parser.add_argument("--interval", type=float, default=300, help="seconds between polls")
+    args = parser.parse_args()
+
+    last = None
+    if args.out.exists() and args.out.stat().st_size >= 2 * RECORD_SIZE:
+        data = args.out.read_bytes()
+        last = data[len(data) - len(data) % RECORD_SIZE - RECORD_SIZE :][:RECORD_SIZE]
+    while True:
+        older, newer = fetch(args.host, 1), fetch(args.host, 0)
+        received = records(older) + records(newer)
+        start = 0
+        if last is not None:
+            if last in received:
+                start = len(received) - received[::-1].index(last)
+            else:
+                print("warning: the trace rotated past the last record seen", file=sys.stderr)
+        new = received[start:]
+        if new:
+            with args.out.open("ab") as out:
+                if out.tell() == 0:
+                    out.write((older or newer)[:RECORD_SIZE])
+                out.write(b"".join(new))
+            last = new[-1]
+        print(f"{time.strftime('%H:%M:%S')} {len(new)} new records")
+        time.sleep(args.interval)
+
+
+if __name__ == "__main__":
+    main()
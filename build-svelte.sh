@@ -6,4 +6,4 @@ set -e
 here="$(readlink -f "$(dirname "$0")")"
 cd "$here/svelte"
 npm run build
-npx --yes svelteesp32 -e psychic -s dist -o ../src/svelteesp32async.h --etag=true
+node embed-assets.mjs dist ../src/web_assets.h
@@ -0,0 +1,146 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#ifndef NATIVE
+#include <Arduino.h>
+#endif
+
+#include "spsc_ring.h"
+
+namespace og3 {
+
+// Push-button gestures from an edge-triggered interrupt.
+//
+// The interrupt handler only timestamps each edge and pushes it into a lock-free ring, so no
+//  press is lost while the main loop is busy.  poll() (from the main loop) takes the edges in
+//  order and debounces them by their timestamps -- a level counts if it lasted debounce_msec
+//  before the next edge, or up to now -- and turns presses into events:
+//  - kLongPress once the button has been held for long_press_msec (nothing on release),
+//  - kDoublePress for a second press released within double_press_msec of the first,
+//  - kPress for a single press, once double_press_msec has passed without a second one.
+// poll() does not read the pin; between edges it only compares timestamps.
+class ButtonEvents {
+ public:
+  enum Event : uint8_t { kPress, kDoublePress, kLongPress };
+
+  struct Options {
+    uint8_t pin;
+    bool pressed_high;  // the pin reads high while the button is pressed
+    unsigned long debounce_msec;
+    unsigned long long_press_msec;
+    unsigned long double_press_msec;
+  };
+
+  explicit ButtonEvents(const Options& options) : m_options(options) {}
+
+  // Start watching the pin, with the button in the state the pin reads now.
+  void begin() {
+#ifndef NATIVE
+    pinMode(m_options.pin, INPUT);
+    begin(static_cast<bool>(digitalRead(m_options.pin)) == m_options.pressed_high);
+#else
+    begin(false);
+#endif
+  }
+  // Start watching the pin, with the button taken to be in the given state.
+  void begin(bool pressed) {
+    m_raw_pressed = m_pressed = pressed;
+#ifndef NATIVE
+    attachInterruptArg(digitalPinToInterrupt(m_options.pin), onEdge, this, CHANGE);
+#endif
+  }
+
+  // Record an edge: called by the interrupt handler (or by the simulator).
+  void addEdge(bool level, unsigned long msec) {
+    if (!m_edges.push({static_cast<uint32_t>(msec), level == m_options.pressed_high})) {
+      m_num_overflows.fetch_add(1);
+    }
+  }
+
+  // Debounce the edges seen so far and detect gestures.  Returns true and sets *event if
+  //  there is an event.  Call from the main loop until it returns false: the edges after the
+  //  one which gave an event are left queued for the next call.
+  bool poll(unsigned long now_msec, Event* event) {
+    Edge edge;
+    while (m_edges.pop(&edge)) {
+      if (edge.pressed == m_raw_pressed) {
+        continue;
+      }
+      // The level before this edge ended at edge.msec.
+      const bool found = advance(edge.msec, event);
+      m_raw_pressed = edge.pressed;
+      m_raw_msec = edge.msec;
+      if (found) {
+        return true;
+      }
+    }
+    return advance(now_msec, event);
+  }
+
+  bool pressed() const { return m_pressed; }
+  // Edges lost because the ring was full.
+  uint32_t numOverflows() const { return m_num_overflows.load(); }
+
+ private:
+  struct Edge {
+    uint32_t msec;
+    bool pressed;
+  };
+
+  // Bring the gesture state up to msec, with the raw level unchanged since m_raw_msec.
+  //  At most one event can happen in one step.
+  bool advance(unsigned long msec, Event* event) {
+    if (m_raw_pressed != m_pressed && msec - m_raw_msec >= m_options.debounce_msec) {
+      m_pressed = m_raw_pressed;
+      if (m_pressed) {
+        m_press_msec = m_raw_msec;
+        m_long_sent = false;
+      } else if (!m_long_sent) {
+        if (m_click_pending && m_raw_msec - m_click_msec <= m_options.double_press_msec) {
+          m_click_pending = false;
+          *event = kDoublePress;
+          return true;
+        }
+        m_click_pending = true;
+        m_click_msec = m_raw_msec;
+      }
+    }
+    if (m_pressed && !m_long_sent && msec - m_press_msec >= m_options.long_press_msec) {
+      m_long_sent = true;
+      m_click_pending = false;
+      *event = kLongPress;
+      return true;
+    }
+    if (m_click_pending && !m_pressed && msec - m_click_msec > m_options.double_press_msec) {
+      m_click_pending = false;
+      *event = kPress;
+      return true;
+    }
+    return false;
+  }
+
+#ifndef NATIVE
+  static void onEdge(void* arg) {
+    auto* self = static_cast<ButtonEvents*>(arg);
+    self->addEdge(digitalRead(self->m_options.pin), millis());
+  }
+#endif
+
+  const Options m_options;
+  SpscRing<Edge, 16> m_edges;
+  std::atomic<uint32_t> m_num_overflows{0};
+  bool m_raw_pressed = false;  // level after the latest edge
+  unsigned long m_raw_msec = 0;
+  bool m_pressed = false;  // debounced level
+  unsigned long m_press_msec = 0;
+  bool m_long_sent = false;
+  bool m_click_pending = false;  // a press was released, and may be the first of a double
+  unsigned long m_click_msec = 0;
+};
+
+}  // namespace og3
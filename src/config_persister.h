@@ -0,0 +1,108 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <og3/variable.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+namespace og3 {
+
+// Coalesces config writes across VariableGroups.
+//
+// Handlers call markDirty() after changing a group and return straight away.  poll() writes
+//  the dirty groups once there have been no changes for quiet_msec, so a burst of changes
+//  (e.g. dragging the target slider) becomes one write per group.  Changes which keep coming
+//  are still written every max_delay_msec.  Call flush() before a restart.
+// markDirty() may be called from the web server's task; poll() and flush() run in the main
+//  loop.
+class ConfigPersister {
+ public:
+  static constexpr unsigned kMaxGroups = 8;
+  using WriteFn = std::function<void(VariableGroup& vg)>;
+  // Called with the groups about to be written: see writes().
+  using PreWriteFn = std::function<void(uint32_t groups)>;
+
+  struct Options {
+    unsigned long quiet_msec;
+    unsigned long max_delay_msec;
+  };
+
+  // pre_write_fn (optional) is called at the start of each flush which writes something.
+  ConfigPersister(const Options& options, const WriteFn& write_fn,
+                  const PreWriteFn& pre_write_fn = nullptr)
+      : m_options(options), m_write_fn(write_fn), m_pre_write_fn(pre_write_fn) {}
+
+  // Register a group which may be marked dirty.  Call during setup.
+  void addGroup(VariableGroup& vg) {
+    if (m_num_groups < kMaxGroups) {
+      m_groups[m_num_groups++] = &vg;
+    }
+  }
+
+  void markDirty(const VariableGroup& vg, unsigned long now_msec) {
+    for (unsigned idx = 0; idx < m_num_groups; idx++) {
+      if (m_groups[idx] == &vg) {
+        m_last_change_msec.store(now_msec);
+        if (0 == m_dirty.fetch_or(1u << idx)) {
+          m_first_change_msec.store(now_msec);
+        }
+        return;
+      }
+    }
+  }
+
+  // Write the dirty groups if changes have stopped, or have waited too long.
+  void poll(unsigned long now_msec) {
+    if (m_dirty.load() == 0) {
+      return;
+    }
+    if (now_msec - m_last_change_msec.load() >= m_options.quiet_msec ||
+        now_msec - m_first_change_msec.load() >= m_options.max_delay_msec) {
+      flush();
+    }
+  }
+
+  // Write the dirty groups now.
+  void flush() {
+    const uint32_t dirty = m_dirty.exchange(0);
+    if (dirty && m_pre_write_fn) {
+      m_pre_write_fn(dirty);
+    }
+    for (unsigned idx = 0; idx < m_num_groups; idx++) {
+      if (dirty & (1u << idx)) {
+        m_write_fn(*m_groups[idx]);
+        m_num_writes += 1;
+      }
+    }
+  }
+
+  // Whether vg is one of the groups passed to a PreWriteFn.
+  bool writes(uint32_t groups, const VariableGroup& vg) const {
+    for (unsigned idx = 0; idx < m_num_groups; idx++) {
+      if (m_groups[idx] == &vg) {
+        return groups & (1u << idx);
+      }
+    }
+    return false;
+  }
+
+  bool dirty() const { return m_dirty.load() != 0; }
+  uint32_t numWrites() const { return m_num_writes; }
+
+ private:
+  const Options m_options;
+  const WriteFn m_write_fn;
+  const PreWriteFn m_pre_write_fn;
+  VariableGroup* m_groups[kMaxGroups] = {};
+  unsigned m_num_groups = 0;
+  std::atomic<uint32_t> m_dirty{0};
+  std::atomic<unsigned long> m_first_change_msec{0};
+  std::atomic<unsigned long> m_last_change_msec{0};
+  uint32_t m_num_writes = 0;
+};
+
+}  // namespace og3
@@ -0,0 +1,165 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <ArduinoJson.h>
+#include <og3/variable.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifndef NATIVE
+#include <LittleFS.h>
+#endif
+
+namespace og3 {
+
+// A binary snapshot of several config VariableGroups, loaded with one file read at boot.
+//
+// The file is a SnapshotHeader followed by a MessagePack map of group name to the group's
+//  config variables.  The header carries a format version and a CRC-32 of the payload, so a
+//  torn or stale-format snapshot is rejected and the caller falls back to the JSON config
+//  files, which stay the source for export and for other tools.
+class ConfigSnapshot {
+ public:
+  static constexpr uint16_t kVersion = 1;
+  static constexpr unsigned kMaxGroups = 4;
+  static constexpr size_t kMaxPayload = 4096;
+
+  struct SnapshotHeader {
+    char magic[4];  // "DCFG"
+    uint16_t version;
+    uint16_t num_groups;
+    uint32_t payload_size;
+    uint32_t crc;  // CRC-32 of the payload
+  };
+
+  explicit ConfigSnapshot(const char* path) : m_path(path) {}
+
+  void addGroup(VariableGroup& vg) {
+    if (m_num_groups < kMaxGroups) {
+      m_groups[m_num_groups++] = &vg;
+    }
+  }
+
+  // Load every group from the snapshot.  Returns false, changing nothing, if the snapshot is
+  //  missing, corrupt, of another version or lacks one of the groups.
+  bool load() {
+    SnapshotHeader header;
+    std::vector<uint8_t> payload;
+    if (!readFile(&header, &payload)) {
+      return false;
+    }
+    if (0 != memcmp(header.magic, "DCFG", 4) || header.version != kVersion ||
+        header.num_groups != m_num_groups || crc32(payload.data(), payload.size()) != header.crc) {
+      return false;
+    }
+    JsonDocument doc;
+    if (deserializeMsgPack(doc, payload.data(), payload.size())) {
+      return false;
+    }
+    for (unsigned idx = 0; idx < m_num_groups; idx++) {
+      if (!doc[m_groups[idx]->name()].is<JsonObject>()) {
+        return false;
+      }
+    }
+    for (unsigned idx = 0; idx < m_num_groups; idx++) {
+      m_groups[idx]->updateFromJson(doc[m_groups[idx]->name()].as<JsonObject>());
+    }
+    return true;
+  }
+
+  // Write all the groups' config variables.  Call before writing their JSON config: a snapshot
+  //  left by a power loss part-way through is then never older than the JSON files.
+  bool save() {
+    JsonDocument doc;
+    for (unsigned idx = 0; idx < m_num_groups; idx++) {
+      JsonObject json = doc[m_groups[idx]->name()].to<JsonObject>();
+      m_groups[idx]->toJson(json, VariableBase::kConfig);
+    }
+    const size_t size = measureMsgPack(doc);
+    if (size > kMaxPayload) {
+      return false;
+    }
+    std::vector<uint8_t> payload(size);
+    serializeMsgPack(doc, payload.data(), payload.size());
+    SnapshotHeader header = {{'D', 'C', 'F', 'G'}, kVersion,
+                             static_cast<uint16_t>(m_num_groups), static_cast<uint32_t>(size),
+                             crc32(payload.data(), size)};
+    return writeFile(header, payload);
+  }
+
+  // CRC-32 (IEEE 802.3, as used by zlib).
+  static uint32_t crc32(const uint8_t* data, size_t len) {
+    uint32_t crc = 0xffffffff;
+    for (size_t idx = 0; idx < len; idx++) {
+      crc ^= data[idx];
+      for (unsigned bit = 0; bit < 8; bit++) {
+        crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+      }
+    }
+    return ~crc;
+  }
+
+ private:
+  bool readFile(SnapshotHeader* header, std::vector<uint8_t>* payload) {
+#ifndef NATIVE
+    File file = LittleFS.open(m_path, "r");
+    if (!file) {
+      return false;
+    }
+    bool ok = sizeof(*header) == file.read(reinterpret_cast<uint8_t*>(header), sizeof(*header)) &&
+              header->payload_size <= kMaxPayload;
+    if (ok) {
+      payload->resize(header->payload_size);
+      ok = payload->size() == file.read(payload->data(), payload->size());
+    }
+    file.close();
+    return ok;
+#else
+    FILE* file = fopen(m_path, "rb");
+    if (!file) {
+      return false;
+    }
+    bool ok = 1 == fread(header, sizeof(*header), 1, file) && header->payload_size <= kMaxPayload;
+    if (ok) {
+      payload->resize(header->payload_size);
+      ok = payload->size() == fread(payload->data(), 1, payload->size(), file);
+    }
+    fclose(file);
+    return ok;
+#endif
+  }
+
+  bool writeFile(const SnapshotHeader& header, const std::vector<uint8_t>& payload) {
+#ifndef NATIVE
+    File file = LittleFS.open(m_path, "w");
+    if (!file) {
+      return false;
+    }
+    const bool ok =
+        sizeof(header) == file.write(reinterpret_cast<const uint8_t*>(&header), sizeof(header)) &&
+        payload.size() == file.write(payload.data(), payload.size());
+    file.close();
+    return ok;
+#else
+    FILE* file = fopen(m_path, "wb");
+    if (!file) {
+      return false;
+    }
+    const bool ok = 1 == fwrite(&header, sizeof(header), 1, file) &&
+                    payload.size() == fwrite(payload.data(), 1, payload.size(), file);
+    fclose(file);
+    return ok;
+#endif
+  }
+
+  const char* const m_path;
+  VariableGroup* m_groups[kMaxGroups] = {};
+  unsigned m_num_groups = 0;
+};
+
+}  // namespace og3
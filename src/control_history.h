@@ -0,0 +1,223 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+#ifndef NATIVE
+#include <freertos/FreeRTOS.h>
+#endif
+
+namespace og3 {
+
+// One history record, in fixed point so that a day of history fits in a small fixed budget.
+// This layout is also the wire format of /api/history (little-endian).
+struct HistorySample {
+  uint32_t sec;             // seconds since boot at the end of the period
+  int16_t enclosure_c100;   // enclosure temperature, °C x 100
+  int16_t room_c100;        // room temperature, °C x 100
+  int16_t target_c100;      // PID target, °C x 100
+  uint8_t enclosure_rh_x2;  // enclosure humidity, % x 2
+  uint8_t room_rh_x2;       // room humidity, % x 2
+  int16_t p_x1e4;           // PID terms, pwm x 10000
+  int16_t i_x1e4;
+  int16_t d_x1e4;
+  int16_t ff_x1e4;
+  uint16_t heater_x1e4;  // heater duty, x 10000
+  uint8_t state;         // TempControl state at the end of the period
+  uint8_t reserved;
+};
+static_assert(sizeof(HistorySample) == 24, "HistorySample is part of the /api/history format");
+
+// Values recorded once per control tick.
+struct HistoryInput {
+  float enclosure_temp;
+  float room_temp;
+  float target;
+  float enclosure_humidity;
+  float room_humidity;
+  float p, i, d, ff;
+  float heater;
+  uint8_t state;
+};
+
+namespace history {
+
+// The HistoryInput fields averaged over a period.
+constexpr float HistoryInput::*kAveraged[] = {
+    &HistoryInput::enclosure_temp,
+    &HistoryInput::room_temp,
+    &HistoryInput::target,
+    &HistoryInput::enclosure_humidity,
+    &HistoryInput::room_humidity,
+    &HistoryInput::p,
+    &HistoryInput::i,
+    &HistoryInput::d,
+    &HistoryInput::ff,
+    &HistoryInput::heater,
+};
+constexpr size_t kNumAveraged = sizeof(kAveraged) / sizeof(kAveraged[0]);
+
+inline int16_t fixed16(float val, float scale) {
+  if (std::isnan(val)) {
+    return INT16_MIN;
+  }
+  const float scaled = std::round(val * scale);
+  return static_cast<int16_t>(std::max(-32767.0f, std::min(32767.0f, scaled)));
+}
+inline uint8_t fixed8(float val, float scale) {
+  if (std::isnan(val)) {
+    return 0;
+  }
+  return static_cast<uint8_t>(std::max(0.0f, std::min(255.0f, std::round(val * scale))));
+}
+
+}  // namespace history
+
+// Convert one set of control values to the fixed-point record format.
+inline HistorySample toHistorySample(uint32_t sec, const HistoryInput& in) {
+  HistorySample sample;
+  sample.sec = sec;
+  sample.enclosure_c100 = history::fixed16(in.enclosure_temp, 100.0f);
+  sample.room_c100 = history::fixed16(in.room_temp, 100.0f);
+  sample.target_c100 = history::fixed16(in.target, 100.0f);
+  sample.enclosure_rh_x2 = history::fixed8(in.enclosure_humidity, 2.0f);
+  sample.room_rh_x2 = history::fixed8(in.room_humidity, 2.0f);
+  sample.p_x1e4 = history::fixed16(in.p, 1e4f);
+  sample.i_x1e4 = history::fixed16(in.i, 1e4f);
+  sample.d_x1e4 = history::fixed16(in.d, 1e4f);
+  sample.ff_x1e4 = history::fixed16(in.ff, 1e4f);
+  sample.heater_x1e4 =
+      std::isnan(in.heater)
+          ? 0
+          : static_cast<uint16_t>(std::max(0.0f, std::min(65535.0f, std::round(in.heater * 1e4f))));
+  sample.state = in.state;
+  sample.reserved = 0;
+  return sample;
+}
+
+// A fixed-size ring of HistorySamples.
+// Control ticks are averaged over kPeriodSec and stored as one sample, so the ring covers
+//  kNumSamples * kPeriodSec seconds in kNumSamples * 24 bytes.  NaN values (e.g. a failed
+//  sensor read) are left out of each field's average; a field with no values in a period is
+//  stored as missing.
+// add() is called from the control loop and copy() from web server handlers, which may run
+//  in another task, so both briefly take a spinlock.
+template <size_t kNumSamples, unsigned kPeriodSec>
+class ControlHistory {
+ public:
+  static constexpr size_t kSize = kNumSamples;
+  static constexpr unsigned kPeriod = kPeriodSec;
+
+  void add(unsigned long now_msec, const HistoryInput& in) {
+    const uint32_t now_sec = now_msec / 1000;
+    const uint32_t period = now_sec / kPeriodSec;
+    if (m_acc_count > 0 && period != m_acc_period) {
+      push(m_acc_period * kPeriodSec + kPeriodSec);
+    }
+    if (m_acc_count == 0) {
+      m_acc = {};
+      std::fill(std::begin(m_field_counts), std::end(m_field_counts), 0);
+      m_acc_period = period;
+    }
+    for (size_t idx = 0; idx < history::kNumAveraged; idx++) {
+      const float val = in.*history::kAveraged[idx];
+      if (!std::isnan(val)) {
+        m_acc.*history::kAveraged[idx] += val;
+        m_field_counts[idx] += 1;
+      }
+    }
+    m_acc.state = in.state;
+    m_acc_count += 1;
+  }
+
+  // Position of a reader in the history, so it can be copied out in small pieces.
+  struct Cursor {
+    bool started = false;
+    uint32_t seq = 0;  // sequence number of the next sample to copy
+  };
+
+  // Copy up to max_out samples recorded after since_sec, continuing from *cursor.
+  // Returns the number copied; call again until it returns 0.
+  // Samples which are overwritten between calls are skipped.
+  size_t copy(uint32_t since_sec, Cursor* cursor, HistorySample* out, size_t max_out) const {
+    lock();
+    const uint32_t oldest_seq = m_num_pushed - m_count;
+    if (!cursor->started) {
+      // Binary search for the first sample after since_sec; times only increase.
+      size_t lo = 0;
+      size_t hi = m_count;
+      while (lo < hi) {
+        const size_t mid = (lo + hi) / 2;
+        if (at(mid).sec <= since_sec) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      cursor->seq = oldest_seq + lo;
+      cursor->started = true;
+    } else if (cursor->seq < oldest_seq) {
+      cursor->seq = oldest_seq;
+    }
+    const size_t start = cursor->seq - oldest_seq;
+    const size_t num = start < m_count ? std::min(max_out, m_count - start) : 0;
+    for (size_t idx = 0; idx < num; idx++) {
+      out[idx] = at(start + idx);
+    }
+    unlock();
+    cursor->seq += num;
+    return num;
+  }
+
+  size_t count() const { return m_count; }
+
+ private:
+  void push(uint32_t sec) {
+    HistoryInput avg = m_acc;
+    for (size_t idx = 0; idx < history::kNumAveraged; idx++) {
+      const unsigned n = m_field_counts[idx];
+      avg.*history::kAveraged[idx] = n > 0 ? m_acc.*history::kAveraged[idx] / n : std::nanf("");
+    }
+    const HistorySample sample = toHistorySample(sec, avg);
+    m_acc_count = 0;
+
+    lock();
+    m_samples[m_next] = sample;
+    m_next = (m_next + 1) % kNumSamples;
+    m_count = std::min(m_count + 1, kNumSamples);
+    m_num_pushed += 1;
+    unlock();
+  }
+
+  // The idx'th oldest sample.
+  const HistorySample& at(size_t idx) const {
+    return m_samples[(m_next + kNumSamples - m_count + idx) % kNumSamples];
+  }
+
+#ifndef NATIVE
+  void lock() const { portENTER_CRITICAL(&m_mux); }
+  void unlock() const { portEXIT_CRITICAL(&m_mux); }
+  mutable portMUX_TYPE m_mux = portMUX_INITIALIZER_UNLOCKED;
+#else
+  void lock() const {}
+  void unlock() const {}
+#endif
+
+  HistorySample m_samples[kNumSamples];
+  size_t m_next = 0;
+  size_t m_count = 0;
+  uint32_t m_num_pushed = 0;
+  HistoryInput m_acc = {};
+  uint32_t m_acc_period = 0;
+  unsigned m_acc_count = 0;
+  unsigned m_field_counts[history::kNumAveraged] = {};  // non-NaN values of each field
+};
+
+}  // namespace og3
@@ -0,0 +1,117 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+#ifndef NATIVE
+#include <esp_timer.h>
+#endif
+
+#include "latency_histogram.h"
+
+#ifdef NATIVE
+unsigned long micros();
+#endif
+
+namespace og3 {
+
+// A fixed-rate tick anchored to absolute deadlines: tick k is due at start + k * period.
+//
+// On the device a periodic esp_timer counts ticks; its period does not drift and is not
+//  affected by how long the main loop takes.  The tick function itself runs from poll() in
+//  the main loop, since the control code shares state with everything else there.  A late
+//  tick is reported in the lateness histogram, and does not delay later deadlines.  If the
+//  main loop misses whole ticks, they are counted as overruns and only the latest one runs.
+// On the host (NATIVE) the deadlines are checked against the (virtual) clock in poll().
+class ControlTicker {
+ public:
+  // Called with the tick's deadline (in the time base of millis()) and the number of
+  //  periods since the previous call (more than 1 after an overrun).
+  using TickFn = std::function<void(unsigned long deadline_msec, uint32_t periods)>;
+
+  ControlTicker(unsigned long period_msec, const TickFn& tick_fn)
+      : m_period_usec(period_msec * 1000ULL), m_tick_fn(tick_fn) {}
+
+  // Start ticking; the first tick is due one period from now.
+  bool begin() {
+    m_start_usec = nowUsec();
+    m_handled = 0;
+#ifndef NATIVE
+    const esp_timer_create_args_t args = {
+        .callback = onTimer,
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "control_tick",
+        .skip_unhandled_events = true,
+    };
+    if (ESP_OK != esp_timer_create(&args, &m_timer) ||
+        ESP_OK != esp_timer_start_periodic(m_timer, m_period_usec)) {
+      return false;
+    }
+#endif
+    m_started = true;
+    return true;
+  }
+
+  // Run the tick function if a tick is due.  Call from the main loop.
+  void poll() {
+    if (!m_started) {
+      return;
+    }
+#ifndef NATIVE
+    const uint32_t due = m_fired.load(std::memory_order_acquire);
+#else
+    const uint32_t due = static_cast<uint32_t>((nowUsec() - m_start_usec) / m_period_usec);
+#endif
+    if (due == m_handled) {
+      return;
+    }
+    const uint32_t periods = due - m_handled;
+    m_num_overruns += periods - 1;
+    m_handled = due;
+    m_num_ticks += 1;
+    const uint64_t deadline_usec = m_start_usec + due * m_period_usec;
+    const uint64_t now_usec = nowUsec();
+    m_lateness_usec.add(now_usec > deadline_usec ? now_usec - deadline_usec : 0);
+    m_tick_fn(static_cast<unsigned long>(deadline_usec / 1000), periods);
+  }
+
+  uint32_t numTicks() const { return m_num_ticks; }
+  // Ticks which were skipped because the main loop did not poll in time.
+  uint32_t numOverruns() const { return m_num_overruns; }
+  // Time from each deadline to the start of its tick, in microseconds.
+  const LatencyHistogram& lateness() const { return m_lateness_usec; }
+  void clearLateness() { m_lateness_usec.clear(); }
+
+ private:
+  static uint64_t nowUsec() {
+#ifndef NATIVE
+    return esp_timer_get_time();
+#else
+    return micros();
+#endif
+  }
+
+#ifndef NATIVE
+  static void onTimer(void* arg) {
+    static_cast<ControlTicker*>(arg)->m_fired.fetch_add(1, std::memory_order_release);
+  }
+  esp_timer_handle_t m_timer = nullptr;
+  std::atomic<uint32_t> m_fired{0};
+#endif
+
+  const uint64_t m_period_usec;
+  const TickFn m_tick_fn;
+  uint64_t m_start_usec = 0;
+  uint32_t m_handled = 0;
+  uint32_t m_num_ticks = 0;
+  uint32_t m_num_overruns = 0;
+  bool m_started = false;
+  LatencyHistogram m_lateness_usec;
+};
+
+}  // namespace og3
@@ -0,0 +1,88 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+#include "latency_histogram.h"
+
+namespace og3 {
+
+#ifndef NATIVE
+inline uint32_t timingUsec() { return micros(); }
+#else
+// On the host, millis() and micros() follow the simulation's virtual clock, so stage costs
+//  are measured with the wall clock instead.  Defined in sim/sim_main.cpp.
+uint32_t timingUsec();
+#endif
+
+// Per-stage timing of TempControl::update(), plus the interval between control ticks.
+// Call start() at the beginning of an update, mark() at the end of each stage and finish()
+//  at the end of the update.
+class ControlTiming {
+ public:
+  enum Stage {
+    kSensors,  // SHTC3 reads
+    kRamp,     // target ramp and feedforward
+    kFilters,  // KernelFilter::addSample()
+    kPid,      // PID::command()
+    kOutputs,  // heater PWM and fan relay writes
+    kMqtt,     // s_app.mqttSend()
+    kTotal,    // all of update()
+    kNumStages,
+  };
+  static constexpr const char* kStageNames[kNumStages] = {
+      "sensors", "ramp", "filters", "pid", "outputs", "mqtt", "total",
+  };
+
+  void start() {
+    m_start_usec = timingUsec();
+    m_mark_usec = m_start_usec;
+  }
+  void mark(Stage stage) {
+    const uint32_t now = timingUsec();
+    m_stages[stage].add(now - m_mark_usec);
+    m_mark_usec = now;
+  }
+  void finish() { m_stages[kTotal].add(timingUsec() - m_start_usec); }
+
+  // Record msec between consecutive ticks of the same periodic schedule.
+  void addInterval(uint32_t msec) { m_interval.add(msec); }
+
+  const LatencyHistogram& stage(Stage stage) const { return m_stages[stage]; }
+  const LatencyHistogram& interval() const { return m_interval; }
+
+  void clear() {
+    for (auto& hist : m_stages) {
+      hist.clear();
+    }
+    m_interval.clear();
+  }
+
+  // One line summarizing a stage, e.g. "pid      n=3600 p50=11 p99=23 max=40 usec".
+  int format(Stage stage, char* out, size_t size) const {
+    return formatHist(kStageNames[stage], m_stages[stage], "usec", out, size);
+  }
+  int formatInterval(char* out, size_t size) const {
+    return formatHist("interval", m_interval, "msec", out, size);
+  }
+
+ private:
+  static int formatHist(const char* name, const LatencyHistogram& hist, const char* units,
+                        char* out, size_t size) {
+    return snprintf(out, size, "%-8s n=%lu p50=%lu p99=%lu max=%lu %s", name,
+                    static_cast<unsigned long>(hist.count()),
+                    static_cast<unsigned long>(hist.percentile(0.5f)),
+                    static_cast<unsigned long>(hist.percentile(0.99f)),
+                    static_cast<unsigned long>(hist.max()), units);
+  }
+
+  LatencyHistogram m_stages[kNumStages];
+  LatencyHistogram m_interval;
+  uint32_t m_start_usec = 0;
+  uint32_t m_mark_usec = 0;
+};
+
+}  // namespace og3
@@ -0,0 +1,219 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <ArduinoJson.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "config_snapshot.h"
+
+namespace og3 {
+
+// A fermentation program: a sequence of temperature segments which the controller follows,
+//  e.g. bulk at 26C for 3 hours, ramp to 22C over an hour, hold overnight, then proof at 27C.
+//
+// Segments are:
+//  - "step": change the setpoint to temp, and stay there for the segment's duration,
+//  - "ramp": move the setpoint linearly to temp over the duration,
+//  - "hold": keep the previous setpoint for the duration.
+// start() precomputes each segment's start time, start temperature and slope, so setpoint()
+//  costs the same on every tick: one multiply-add, and an index step when a segment ends.
+//  The controller's ramp-rate limit still smooths steps.
+// A run follows elapsed time since its start.  The caller saves RunState from time to time
+//  so that a run can be resumed where it was after a restart.
+class FermentProgram {
+ public:
+  static constexpr unsigned kMaxSegments = 16;
+  static constexpr size_t kMaxName = 24;
+
+  enum class Kind : uint8_t { kStep, kRamp, kHold };
+  static constexpr const char* kKindNames[] = {"step", "ramp", "hold"};
+
+  struct Segment {
+    Kind kind;
+    float temp;  // unused for kHold
+    uint32_t sec;
+  };
+
+  // The progress of a run, as saved to flash.
+  struct RunState {
+    char magic[4];         // "DPRG"
+    uint32_t program_crc;  // crc() of the program the run was started with
+    float start_temp;
+    uint32_t elapsed_sec;
+    uint32_t epoch_sec;  // wall-clock time of the save, or 0 if the clock was not set
+    uint32_t crc;        // CRC-32 of the fields above
+
+    uint32_t computeCrc() const {
+      return ConfigSnapshot::crc32(reinterpret_cast<const uint8_t*>(this),
+                                   offsetof(RunState, crc));
+    }
+    bool valid() const { return 0 == memcmp(magic, "DPRG", 4) && crc == computeCrc(); }
+  };
+
+  // Replace the program with the one in json, e.g.
+  //   {"name": "overnight", "segments": [{"type": "step", "temp": 26, "min": 180},
+  //                                       {"type": "ramp", "temp": 22, "min": 60}, ...]}
+  // Returns nullptr, or a description of the problem, in which case nothing is changed.
+  // A running program is stopped.
+  const char* fromJson(JsonObject json, float min_temp, float max_temp) {
+    JsonArray segments = json["segments"].as<JsonArray>();
+    if (segments.size() == 0) {
+      return "no segments";
+    }
+    if (segments.size() > kMaxSegments) {
+      return "too many segments";
+    }
+    Segment parsed[kMaxSegments];
+    for (unsigned idx = 0; idx < segments.size(); idx++) {
+      JsonVariant segment = segments[idx];
+      const char* type = segment["type"].as<const char*>();
+      unsigned kind = 0;
+      while (kind < 3 && !(type && 0 == strcmp(type, kKindNames[kind]))) {
+        kind++;
+      }
+      if (kind == 3) {
+        return "segment type must be step, ramp or hold";
+      }
+      const float minutes = segment["min"].as<float>();
+      if (!(minutes >= 0.0f && minutes <= kMaxSegmentMinutes)) {
+        return "segment min out of range";
+      }
+      parsed[idx] = {static_cast<Kind>(kind), segment["temp"].as<float>(),
+                     static_cast<uint32_t>(minutes * 60.0f + 0.5f)};
+      if (parsed[idx].kind != Kind::kHold &&
+          !(parsed[idx].temp >= min_temp && parsed[idx].temp <= max_temp)) {
+        return "segment temp out of range";
+      }
+    }
+    m_running = false;
+    m_num_segments = segments.size();
+    memcpy(m_segments, parsed, sizeof(Segment) * m_num_segments);
+    const char* name = json["name"].as<const char*>();
+    strncpy(m_name, name ? name : "", sizeof(m_name) - 1);
+    m_name[sizeof(m_name) - 1] = 0;
+    return nullptr;
+  }
+
+  void toJson(JsonObject json) const {
+    json["name"] = m_name;
+    JsonArray segments = json["segments"].to<JsonArray>();
+    for (unsigned idx = 0; idx < m_num_segments; idx++) {
+      JsonObject segment = segments.add<JsonObject>();
+      segment["type"] = kKindNames[static_cast<unsigned>(m_segments[idx].kind)];
+      if (m_segments[idx].kind != Kind::kHold) {
+        segment["temp"] = m_segments[idx].temp;
+      }
+      segment["min"] = m_segments[idx].sec / 60.0f;
+    }
+  }
+
+  // Identifies the program, so a saved run is only resumed with the program it started with.
+  uint32_t crc() const {
+    uint8_t buf[sizeof(m_name) + sizeof(m_segments)];
+    memcpy(buf, m_name, sizeof(m_name));
+    for (unsigned idx = 0; idx < m_num_segments; idx++) {
+      uint8_t* out = buf + sizeof(m_name) + idx * kSegmentBytes;
+      out[0] = static_cast<uint8_t>(m_segments[idx].kind);
+      memcpy(out + 1, &m_segments[idx].temp, sizeof(float));
+      memcpy(out + 5, &m_segments[idx].sec, sizeof(uint32_t));
+    }
+    return ConfigSnapshot::crc32(buf, sizeof(m_name) + m_num_segments * kSegmentBytes);
+  }
+
+  // Start a run with the setpoint at start_temp, or resume one elapsed_sec into the program.
+  bool start(float start_temp, uint32_t elapsed_sec, unsigned long now_msec) {
+    if (m_num_segments == 0) {
+      return false;
+    }
+    uint32_t begin_sec = 0;
+    float temp = start_temp;
+    for (unsigned idx = 0; idx < m_num_segments; idx++) {
+      const Segment& segment = m_segments[idx];
+      const float end_temp = segment.kind == Kind::kHold ? temp : segment.temp;
+      m_legs[idx].begin_sec = begin_sec;
+      m_legs[idx].start_temp = segment.kind == Kind::kRamp ? temp : end_temp;
+      m_legs[idx].slope = segment.kind == Kind::kRamp && segment.sec > 0
+                              ? (end_temp - temp) / segment.sec
+                              : 0.0f;
+      begin_sec += segment.sec;
+      temp = end_temp;
+    }
+    m_total_sec = begin_sec;
+    m_final_temp = temp;
+    m_start_temp = start_temp;
+    m_start_msec = now_msec;
+    m_start_elapsed_sec = elapsed_sec;
+    m_index = 0;
+    m_running = true;
+    return true;
+  }
+  void stop() { m_running = false; }
+
+  // Move a run on by sec, e.g. for time the device was switched off.
+  void skip(uint32_t sec) { m_start_elapsed_sec += sec; }
+
+  bool running() const { return m_running; }
+  unsigned numSegments() const { return m_num_segments; }
+  const Segment& segment(unsigned idx) const { return m_segments[idx]; }
+  const char* name() const { return m_name; }
+  uint32_t totalSec() const { return m_total_sec; }
+  float finalTemp() const { return m_final_temp; }
+
+  // Time into the program.  now_msec may be a tick deadline slightly before the start.
+  uint32_t elapsedSec(unsigned long now_msec) const {
+    const long run_msec = static_cast<long>(now_msec - m_start_msec);
+    return m_start_elapsed_sec + (run_msec > 0 ? run_msec / 1000 : 0);
+  }
+  bool finished(unsigned long now_msec) const { return elapsedSec(now_msec) >= m_total_sec; }
+
+  // The setpoint now.  Call with non-decreasing times while running.
+  float setpoint(unsigned long now_msec) {
+    const uint32_t elapsed_sec = elapsedSec(now_msec);
+    while (m_index + 1 < m_num_segments && elapsed_sec >= m_legs[m_index + 1].begin_sec) {
+      m_index++;
+    }
+    if (elapsed_sec >= m_total_sec) {
+      return m_final_temp;
+    }
+    const Leg& leg = m_legs[m_index];
+    return leg.start_temp + leg.slope * (elapsed_sec - leg.begin_sec);
+  }
+  // The segment found by the last call to setpoint().
+  unsigned segmentIndex() const { return m_index; }
+
+  RunState runState(unsigned long now_msec, uint32_t epoch_sec) const {
+    RunState state = {{'D', 'P', 'R', 'G'}, crc(), m_start_temp, elapsedSec(now_msec),
+                      epoch_sec, 0};
+    state.crc = state.computeCrc();
+    return state;
+  }
+
+ private:
+  static constexpr float kMaxSegmentMinutes = 7 * 24 * 60;
+  static constexpr size_t kSegmentBytes = 9;
+
+  struct Leg {
+    uint32_t begin_sec;
+    float start_temp;
+    float slope;  // °C/sec
+  };
+
+  char m_name[kMaxName] = {};
+  Segment m_segments[kMaxSegments] = {};
+  unsigned m_num_segments = 0;
+  Leg m_legs[kMaxSegments] = {};
+  uint32_t m_total_sec = 0;
+  float m_final_temp = 0.0f;
+  float m_start_temp = 0.0f;
+  unsigned long m_start_msec = 0;
+  uint32_t m_start_elapsed_sec = 0;
+  unsigned m_index = 0;
+  bool m_running = false;
+};
+
+}  // namespace og3
@@ -0,0 +1,77 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace og3 {
+
+// The temperature the static feedforward is relative to: the heater makes up the loss through
+//  the insulation, which is proportional to the enclosure-to-room difference.
+//
+// While the room sensor works the reference is the filtered room temperature, so the
+//  feedforward follows the kitchen as it cools overnight instead of leaving the drift to the
+//  integrator.  When the sensor stops working the last room temperature is held, as rooms
+//  change slowly and it is a better guess than anything else to hand.  Only if there has been
+//  no room temperature does the reference fall back to the given fallback temperature (the
+//  enclosure temperature when control was enabled).  The reference moves at no more than
+//  max_slew (°C/sec), so the sensor coming back after a while does not step the heater output.
+class FeedforwardReference {
+ public:
+  enum class Source : uint8_t { kNone, kRoom, kHeld, kFallback };
+  static constexpr const char* kSourceNames[] = {"none", "room", "held", "fallback"};
+
+  struct Options {
+    float max_slew;  // °C/sec
+  };
+
+  explicit FeedforwardReference(const Options& options) : m_options(options) {}
+
+  // Call on each control update.  room_temp is used only if room_ok, and fallback_temp may be
+  //  NaN if there is none.  Returns the new reference, or NaN if there is none yet.
+  float update(unsigned long now_msec, bool room_ok, float room_temp, float fallback_temp) {
+    float want = m_value;
+    if (room_ok) {
+      want = room_temp;
+      m_source = Source::kRoom;
+      m_room_temp = room_temp;
+      m_have_room = true;
+    } else if (m_have_room) {
+      want = m_room_temp;
+      m_source = Source::kHeld;
+    } else if (!std::isnan(fallback_temp)) {
+      want = fallback_temp;
+      m_source = Source::kFallback;
+    } else {
+      m_source = Source::kNone;
+    }
+    if (std::isnan(m_value)) {
+      m_value = want;
+    } else {
+      const float max_step = m_options.max_slew * (now_msec - m_last_msec) * 1e-3f;
+      m_value += std::max(-max_step, std::min(max_step, want - m_value));
+    }
+    m_last_msec = now_msec;
+    return m_value;
+  }
+
+  // Start again from the current source on the next update, e.g. when control is enabled.
+  void reset() { m_value = std::nanf(""); }
+
+  float value() const { return m_value; }
+  Source source() const { return m_source; }
+  const char* sourceName() const { return kSourceNames[static_cast<unsigned>(m_source)]; }
+
+ private:
+  const Options m_options;
+  float m_value = std::nanf("");
+  Source m_source = Source::kNone;
+  float m_room_temp = 0.0f;
+  unsigned long m_last_msec = 0;
+  bool m_have_room = false;
+};
+
+}  // namespace og3
@@ -0,0 +1,155 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <ArduinoJson.h>
+#include <og3/ha_app.h>
+#include <og3/tasks.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+namespace og3 {
+
+// Sends the Home Assistant discovery entries only when they change, or when Home Assistant
+//  asks for them.
+//
+// og3's HADiscovery calls every discovery callback each time the MQTT connection is made, and
+//  each callback builds its entry's JSON and publishes it (retained).  When a broker restarts,
+//  every device on it does this at the same moment.  Here each entry has a content hash, and
+//  a callback only sends its entry if the hash differs from the one last sent: the broker
+//  still holds the retained config.  When Home Assistant publishes its birth message (it
+//  restarted, or the broker lost the retained configs), all entries are sent again, one every
+//  pace_msec, starting after a delay between 0 and max_delay_msec which differs between
+//  devices so they do not all announce at once.
+class HaAnnouncer {
+ public:
+  // The hash of what the entry would send, e.g. of its serialized JSON or of its inputs.
+  using HashFn = std::function<uint32_t()>;
+  // Build the entry in json and publish it, like an og3 discovery callback.
+  using SendFn = std::function<bool(HADiscovery*, JsonDocument*)>;
+
+  struct Options {
+    unsigned long pace_msec;
+    unsigned long max_delay_msec;
+  };
+
+  HaAnnouncer(const Options& options, Tasks* tasks) : m_options(options), m_scheduler(tasks) {}
+
+  // FNV-1a, chained through hash so several fields can be combined.
+  static uint32_t hash(const void* data, size_t len, uint32_t hash = kFnvBasis) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t idx = 0; idx < len; idx++) {
+      hash = (hash ^ bytes[idx]) * kFnvPrime;
+    }
+    return hash;
+  }
+  static uint32_t hash(const char* text, uint32_t hash_in = kFnvBasis) {
+    return text ? hash(text, strlen(text) + 1, hash_in) : hash("", 1, hash_in);
+  }
+
+  // A HashFn for an entry made by one of HADiscovery's helpers (addMeas() etc.), which build
+  //  and send the JSON in one call: the hash of what the entry is made from.
+  static HashFn inputsHash(HADiscovery* had, const VariableBase& var, const char* device_type,
+                           const char* device_class) {
+    return [had, &var, device_type, device_class]() {
+      uint32_t out = hash(had->deviceId());
+      out = hash(var.name(), out);
+      out = hash(device_type, out);
+      return hash(device_class, out);
+    };
+  }
+
+  // Add an entry, and register it with had as a discovery callback.
+  void add(HADiscovery* had, const HashFn& hash_fn, const SendFn& send_fn) {
+    const size_t idx = m_entries.size();
+    m_entries.push_back({hash_fn, send_fn, 0, false});
+    had->addDiscoveryCallback(
+        [this, idx](HADiscovery* had, JsonDocument* json) { return announce(idx, had, json); });
+  }
+
+  // Call with the payload of Home Assistant's status topic, from the MQTT callback.  This runs
+  //  in the MQTT client's task, so it only notes the birth message for poll().
+  void onStatus(HADiscovery* had, const char* payload, size_t len) {
+    if (len == 6 && 0 == strncmp(payload, "online", 6)) {
+      m_birth_had.store(had);
+    }
+  }
+
+  // Call from the main loop: starts sending the entries again after a birth message.
+  void poll() {
+    if (HADiscovery* had = m_birth_had.exchange(nullptr)) {
+      startAnnounce(had);
+    }
+  }
+
+  // Entries published, and discovery callbacks which had nothing new to send.
+  uint32_t numSent() const { return m_num_sent; }
+  uint32_t numSkipped() const { return m_num_skipped; }
+
+ private:
+  static constexpr uint32_t kFnvBasis = 2166136261u;
+  static constexpr uint32_t kFnvPrime = 16777619u;
+
+  struct Entry {
+    HashFn hash_fn;
+    SendFn send_fn;
+    uint32_t sent_hash;
+    bool sent;
+  };
+
+  bool announce(size_t idx, HADiscovery* had, JsonDocument* json) {
+    Entry& entry = m_entries[idx];
+    const uint32_t content_hash = entry.hash_fn();
+    if (entry.sent && content_hash == entry.sent_hash) {
+      m_num_skipped++;
+      return true;
+    }
+    if (!entry.send_fn(had, json)) {
+      return false;
+    }
+    entry.sent_hash = content_hash;
+    entry.sent = true;
+    m_num_sent++;
+    return true;
+  }
+
+  void startAnnounce(HADiscovery* had) {
+    for (Entry& entry : m_entries) {
+      entry.sent = false;
+    }
+    const unsigned long delay_msec =
+        m_options.max_delay_msec ? hash(had->deviceId()) % m_options.max_delay_msec : 0;
+    m_next = 0;
+    m_scheduler.runIn(delay_msec + 1, [this, had]() { announceNext(had); });
+  }
+
+  // Send the entries after a birth message, one at a time.  If one fails (MQTT is
+  //  disconnected), the rest are left to the discovery pass when it reconnects.
+  void announceNext(HADiscovery* had) {
+    while (m_next < m_entries.size() && m_entries[m_next].sent) {
+      m_next++;
+    }
+    if (m_next == m_entries.size()) {
+      return;
+    }
+    JsonDocument json;
+    if (announce(m_next, had, &json)) {
+      m_scheduler.runIn(m_options.pace_msec, [this, had]() { announceNext(had); });
+    }
+  }
+
+  const Options m_options;
+  TaskIdScheduler m_scheduler;
+  std::vector<Entry> m_entries;
+  std::atomic<HADiscovery*> m_birth_had{nullptr};  // set by onStatus(), taken by poll()
+  size_t m_next = 0;
+  uint32_t m_num_sent = 0;
+  uint32_t m_num_skipped = 0;
+};
+
+}  // namespace og3
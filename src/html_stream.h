@@ -0,0 +1,109 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <og3/web.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace og3 {
+
+// Streams an HTML page as chunked transfer encoding from a small fixed buffer.
+//
+// Building a whole page into one String puts all of it on the heap at once, and a String
+//  shared between handlers is overwritten by concurrent requests.  Here text is copied into a
+//  buffer on the handler's stack and sent as a chunk whenever the buffer fills.  og3's html::
+//  writers append to a String, so writeWith() runs one into the request's own scratch String
+//  and streams that, and the scratch only grows to the size of the largest table.
+// On the host (NATIVE) the page is collected and sent at the end.
+class HtmlChunkWriter {
+ public:
+  static constexpr size_t kBufferSize = 512;
+
+  HtmlChunkWriter(NetRequest* request, NetResponse* response)
+      : m_request(request), m_response(response) {
+#ifndef NATIVE
+    m_response->setCode(200);
+    m_response->setContentType("text/html");
+    m_response->addHeader("Cache-Control", "no-store");
+    m_ok = ESP_OK == m_response->sendHeaders();
+#endif
+  }
+
+  void write(const char* text, size_t len) {
+    while (m_ok && len > 0) {
+      const size_t num = std::min(len, kBufferSize - m_len);
+      memcpy(m_buffer + m_len, text, num);
+      m_len += num;
+      text += num;
+      len -= num;
+      if (m_len == kBufferSize) {
+        flush();
+      }
+    }
+  }
+  void write(const char* text) { write(text, strlen(text)); }
+
+  // Stream what write_fn(String*) appends, e.g. html::writeTableInto() or WebButton::add_button().
+  template <typename WriteFn>
+  void writeWith(WriteFn&& write_fn) {
+    m_scratch.clear();
+    write_fn(&m_scratch);
+    write(m_scratch.c_str(), m_scratch.length());
+  }
+
+  // Stream tmpl, calling expand(name, len) to write each {{name}} in it.
+  template <typename ExpandFn>
+  void writeTemplate(const char* tmpl, ExpandFn&& expand) {
+    while (const char* open = strstr(tmpl, "{{")) {
+      const char* close = strstr(open + 2, "}}");
+      if (!close) {
+        break;
+      }
+      write(tmpl, open - tmpl);
+      expand(open + 2, static_cast<size_t>(close - open - 2));
+      tmpl = close + 2;
+    }
+    write(tmpl);
+  }
+
+  // Send what is left and end the response.
+  NetHandlerStatus end() {
+    flush();
+#ifndef NATIVE
+    if (m_ok) {
+      m_response->finishChunking();
+    }
+#else
+    m_response->send(200, "text/html", m_page.c_str());
+#endif
+    NET_REPLY(m_request, m_ok ? ESP_OK : ESP_FAIL);
+  }
+
+ private:
+  void flush() {
+    if (m_ok && m_len > 0) {
+#ifndef NATIVE
+      m_ok = ESP_OK == m_response->sendChunk(reinterpret_cast<uint8_t*>(m_buffer), m_len);
+#else
+      m_page.append(m_buffer, m_len);
+#endif
+    }
+    m_len = 0;
+  }
+
+  NetRequest* const m_request;
+  NetResponse* const m_response;
+  bool m_ok = true;  // false once the client has gone away
+  char m_buffer[kBufferSize];
+  size_t m_len = 0;
+  String m_scratch;
+#ifdef NATIVE
+  std::string m_page;
+#endif
+};
+
+}  // namespace og3
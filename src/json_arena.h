@@ -0,0 +1,156 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <ArduinoJson.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace og3 {
+
+// An ArduinoJson allocator which hands out memory from a fixed buffer and never touches
+//  the heap.  Memory is reclaimed all at once by reset(), once the document is gone.
+// If the buffer is exhausted, allocation fails and the document reports overflowed().
+class ArenaAllocator : public ArduinoJson::Allocator {
+ public:
+  ArenaAllocator(uint8_t* buffer, size_t size) : m_buffer(buffer), m_size(size) {}
+
+  void* allocate(size_t size) override {
+    const size_t start = align(m_used);
+    if (start + size > m_size) {
+      return nullptr;
+    }
+    m_last = m_buffer + start;
+    m_used = start + size;
+    return m_last;
+  }
+  void deallocate(void* ptr) override {
+    // Only the most recent allocation can be given back.
+    if (ptr && ptr == m_last) {
+      m_used = static_cast<uint8_t*>(ptr) - m_buffer;
+      m_last = nullptr;
+    }
+  }
+  void* reallocate(void* ptr, size_t new_size) override {
+    if (!ptr) {
+      return allocate(new_size);
+    }
+    if (ptr == m_last) {
+      // Grow or shrink the most recent allocation in place.
+      const size_t start = static_cast<uint8_t*>(ptr) - m_buffer;
+      if (start + new_size > m_size) {
+        return nullptr;
+      }
+      m_used = start + new_size;
+      return ptr;
+    }
+    void* out = allocate(new_size);
+    if (out) {
+      // The old block is inside the arena, so copying new_size bytes cannot read past it.
+      const size_t available = m_buffer + m_size - static_cast<uint8_t*>(ptr);
+      memcpy(out, ptr, new_size < available ? new_size : available);
+    }
+    return out;
+  }
+
+  void reset() {
+    m_used = 0;
+    m_last = nullptr;
+  }
+  size_t used() const { return m_used; }
+
+ private:
+  static size_t align(size_t offset) {
+    return (offset + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+  }
+
+  uint8_t* const m_buffer;
+  const size_t m_size;
+  size_t m_used = 0;
+  void* m_last = nullptr;
+};
+
+// Fixed storage for building and serializing one JSON document without heap allocation.
+template <size_t kArenaSize, size_t kOutSize>
+class JsonScratch {
+ public:
+  JsonScratch() : m_allocator(m_arena, sizeof(m_arena)) {}
+
+  // Build a document with fill_fn(JsonObject&) and serialize it into out().
+  // Returns the serialized length, or 0 if the document did not fit.
+  template <typename FillFn>
+  size_t build(FillFn&& fill_fn) {
+    size_t len = 0;
+    {
+      JsonDocument jsondoc(&m_allocator);
+      JsonObject json = jsondoc.to<JsonObject>();
+      fill_fn(json);
+      if (!jsondoc.overflowed()) {
+        len = serializeJson(jsondoc, m_out, sizeof(m_out));
+        if (len >= sizeof(m_out) - 1) {
+          len = 0;  // Output was truncated.
+        }
+      }
+    }
+    m_allocator.reset();
+    if (len == 0) {
+      m_out[0] = '\0';
+    }
+    return len;
+  }
+
+  const char* out() const { return m_out; }
+
+ private:
+  alignas(std::max_align_t) uint8_t m_arena[kArenaSize];
+  ArenaAllocator m_allocator;
+  char m_out[kOutSize];
+};
+
+// A small fixed set of JsonScratch buffers, so concurrent requests each get their own
+//  storage without allocating.  Slots are claimed with an atomic flag.
+template <size_t kSlots, size_t kArenaSize, size_t kOutSize>
+class JsonScratchPool {
+ public:
+  using Scratch = JsonScratch<kArenaSize, kOutSize>;
+
+  // Holds a slot for the lifetime of the object.  ok() is false if all slots were busy.
+  class Lease {
+   public:
+    explicit Lease(JsonScratchPool* pool) : m_pool(pool), m_idx(pool->claim()) {}
+    ~Lease() { m_pool->release(m_idx); }
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+
+    bool ok() const { return m_idx < kSlots; }
+    Scratch& scratch() { return m_pool->m_scratch[m_idx]; }
+
+   private:
+    JsonScratchPool* const m_pool;
+    const size_t m_idx;
+  };
+
+ private:
+  size_t claim() {
+    for (size_t idx = 0; idx < kSlots; idx++) {
+      if (!m_busy[idx].exchange(true, std::memory_order_acquire)) {
+        return idx;
+      }
+    }
+    return kSlots;
+  }
+  void release(size_t idx) {
+    if (idx < kSlots) {
+      m_busy[idx].store(false, std::memory_order_release);
+    }
+  }
+
+  Scratch m_scratch[kSlots];
+  std::atomic<bool> m_busy[kSlots] = {};
+};
+
+}  // namespace og3
@@ -0,0 +1,88 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace og3 {
+
+// Fixed-size histogram of durations (or any non-negative integer), cheap enough to leave
+//  enabled in production.
+// Values below 16 each have their own bucket.  Above that, each power of two is split into
+//  four buckets, so a reported percentile is within 25% of the true value.
+class LatencyHistogram {
+ public:
+  static constexpr unsigned kLinearBuckets = 16;
+  static constexpr unsigned kSubBuckets = 4;
+  static constexpr unsigned kNumBuckets = kLinearBuckets + (32 - 4) * kSubBuckets;
+
+  void add(uint32_t val) {
+    m_counts[bucket(val)] += 1;
+    m_count += 1;
+    m_sum += val;
+    if (val > m_max) {
+      m_max = val;
+    }
+  }
+
+  void clear() {
+    memset(m_counts, 0, sizeof(m_counts));
+    m_count = 0;
+    m_sum = 0;
+    m_max = 0;
+  }
+
+  uint32_t count() const { return m_count; }
+  uint32_t max() const { return m_max; }
+  uint64_t sum() const { return m_sum; }
+  uint32_t mean() const { return m_count ? static_cast<uint32_t>(m_sum / m_count) : 0; }
+
+  // Upper edge of the bucket holding the given fraction (0-1) of samples.
+  uint32_t percentile(float fraction) const {
+    if (m_count == 0) {
+      return 0;
+    }
+    const uint64_t goal = static_cast<uint64_t>(fraction * m_count + 0.5f);
+    uint64_t total = 0;
+    for (unsigned idx = 0; idx < kNumBuckets; idx++) {
+      total += m_counts[idx];
+      if (total >= goal && total > 0) {
+        const uint32_t edge = upperEdge(idx);
+        return edge < m_max ? edge : m_max;
+      }
+    }
+    return m_max;
+  }
+
+  uint32_t bucketCount(unsigned idx) const { return m_counts[idx]; }
+
+  static unsigned bucket(uint32_t val) {
+    if (val < kLinearBuckets) {
+      return val;
+    }
+    const unsigned msb = 31 - __builtin_clz(val);  // >= 4
+    const unsigned sub = (val >> (msb - 2)) & (kSubBuckets - 1);
+    return kLinearBuckets + (msb - 4) * kSubBuckets + sub;
+  }
+
+  static uint32_t upperEdge(unsigned idx) {
+    if (idx < kLinearBuckets) {
+      return idx;
+    }
+    const unsigned msb = 4 + (idx - kLinearBuckets) / kSubBuckets;
+    const unsigned sub = (idx - kLinearBuckets) % kSubBuckets;
+    const uint64_t lower = static_cast<uint64_t>(kSubBuckets + sub) << (msb - 2);
+    const uint64_t upper = lower + (1ull << (msb - 2)) - 1;
+    return upper > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(upper);
+  }
+
+ private:
+  uint32_t m_counts[kNumBuckets] = {};
+  uint32_t m_count = 0;
+  uint64_t m_sum = 0;
+  uint32_t m_max = 0;
+};
+
+}  // namespace og3
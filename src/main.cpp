@@ -1,31 +1,67 @@
 // Copyright (c) 2026 Chris Lee and contributors.
 // Licensed under the MIT license. See LICENSE file in the project root for details.
 
+#ifndef NATIVE
 #include <Arduino.h>
 #include <LittleFS.h>
+#include <WiFi.h>
+#endif
 #include <og3/blink_led.h>
 #include <og3/constants.h>
-#include <og3/din.h>
 #include <og3/ha_app.h>
 #include <og3/html_table.h>
 #include <og3/kernel_filter.h>
-#include <og3/oled_display_ring.h>
-#include <og3/oled_wifi_info.h>
 #include <og3/pid.h>
+#ifndef NATIVE
 #include <og3/pwm.h>
 #include <og3/relay.h>
 #include <og3/shtc3.h>
+#endif
 #include <og3/units.h>
 #include <og3/variable.h>
 #include <og3/web.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstring>
+#include <ctime>
 #include <functional>
 #include <limits>
+#include <utility>
+#include <vector>
+
+#include "button_events.h"
+#include "control_history.h"
+#include "control_ticker.h"
+#include "config_persister.h"
+#include "config_snapshot.h"
+#include "control_timing.h"
+#include "ferment_program.h"
+#include "ff_reference.h"
+#include "ha_announcer.h"
+#include "html_stream.h"
+#include "json_arena.h"
+#include "mqtt_change_publisher.h"
+#include "mqtt_commands.h"
+#include "oled_pipeline.h"
+#include "perf_counters.h"
+#include "recursive_filter.h"
+#include "relay_autotune.h"
+#include "sensor_cache.h"
+#include "sensor_task.h"
+#include "thermal_model.h"
+#include "trace_log.h"
+#ifndef NATIVE
+#include "shtc3_bus.h"
+#include "web_assets.h"
+#else
+// Host build: the peripherals are backed by a simulated thermal plant.
+#include <random>
 
-#include "svelteesp32async.h"
+#include "sim/sim.h"
+#include "sim/sim_hardware.h"
+#endif
 
 #define VERSION "1.0.0"
 
@@ -55,6 +91,30 @@ constexpr double kHeaterPwmFrequency = 100;  // Pwm::kAnalogWriteFreqMin;  // 10
 constexpr double kSafetyPwmFrequency = 200;
 // Time to turn on relay from web button press.
 constexpr int kFanOnMsec = 60 * kMsecInSec;
+// Config changes are written to flash once they stop for kConfigQuietMsec, or at the latest
+//  kConfigMaxDelayMsec after the first change.
+constexpr unsigned long kConfigQuietMsec = 2 * kMsecInSec;
+constexpr unsigned long kConfigMaxDelayMsec = 30 * kMsecInSec;
+// Power button gestures.
+constexpr unsigned long kButtonDebounceMsec = 30;
+constexpr unsigned long kButtonLongPressMsec = 1500;
+constexpr unsigned long kButtonDoublePressMsec = 400;
+// The control tick runs every kUpdateOnMsec, at fixed deadlines.  Ramping tolerates a few
+//  missed ticks; beyond that the target is held rather than stepped.
+constexpr float kMaxRampDtSec = 5.0f;
+// Control tick lateness is summarized over this many ticks.
+constexpr unsigned kTickStatsTicks = 600;
+// Performance counter variables are refreshed (and sent over MQTT if perfMqtt is set) this
+//  often.
+constexpr unsigned kPerfPublishTicks = 60;
+// The sensor task samples both SHTC3s twice per control tick, retrying failed reads.
+//  Control treats the enclosure sensor as failed if it has no good sample this recent.
+constexpr unsigned long kSensorPeriodMsec = 500;
+constexpr unsigned kSensorRetries = 2;
+constexpr unsigned long kMaxSensorAgeMsec = 5 * kSensorPeriodMsec;
+// The display and web API re-use a sensor sample until it is this old.  The control tick
+//  takes a new sample every tick regardless.
+constexpr float kDefaultSensorMaxAgeSec = 1.0f;
 
 constexpr float kDefaultTargetTemp = 27.0f;
 constexpr float kDefaultMinValidTemp = 10.0f;
@@ -67,15 +127,69 @@ constexpr float kDefaultCtlIMax = 0.15f;
 constexpr float kDefaultCtlFFPerDeltaC = 0.01f;
 constexpr float kDefaultRampRate = 0.05f;  // °C/sec
 constexpr float kDefaultFFPerRate = 0.0f;  // pwm / (°C/sec)
+// MQTT publishing: values must move this much before they are re-sent.
+constexpr float kDefaultMqttTempDeadband = 0.05f;     // °C
+constexpr float kDefaultMqttHumidityDeadband = 0.5f;  // %
+constexpr float kDefaultMqttDutyDeadband = 0.01f;     // heater pwm
+constexpr float kDefaultMqttKeepaliveSec = 60.0f;     // Re-send unchanged values this often.
+// Home Assistant discovery: after HA's birth message, wait up to 10 seconds (depending on the
+//  device) and then send one entry every 200 msec.
+constexpr char kHaStatusTopic[] = "homeassistant/status";
+constexpr char kHaThermostatName[] = "thermostat";
+constexpr unsigned long kHaAnnouncePaceMsec = 200;
+constexpr unsigned long kHaAnnounceMaxDelayMsec = 10 * kMsecInSec;
+// Relay autotune: heater duty while below the setpoint, and the switching band.
+constexpr float kDefaultAutotuneOutput = 0.3f;
+constexpr float kDefaultAutotuneHysteresis = 0.2f;  // °C
+constexpr unsigned kAutotuneCycles = 3;
+constexpr unsigned long kAutotuneMaxMsec = 6 * 3600 * kMsecInSec;
+// Online thermal model for adaptive feedforward: one RLS update per minute, forgetting
+//  old updates with a time constant of about 100 minutes.
+constexpr unsigned long kThermalModelPeriodMsec = 60 * kMsecInSec;
+constexpr float kDefaultFFModelForgetting = 0.99f;
+constexpr unsigned kThermalModelMinUpdates = 10;
+constexpr float kThermalModelMaxRelStddev = 0.3f;
 constexpr float kTargetTempMax = 35.0f;
 constexpr float kTargetTempMin = 15.0f;
+// Static feedforward reference: the room temperature through two 2-minute filter stages,
+//  moved at up to 1°C a minute.
+constexpr float kRoomFilterTauSec = 120.0f;
+constexpr float kFFReferenceSlew = 1.0f / 60.0f;  // °C/sec
 
 constexpr uint8_t kPwmChannel = 0;
 constexpr uint8_t kSafetyPwmChannel = 1;
 constexpr uint8_t kPwmResolution = 16;
 
-// Delay between updates of the OLED.
+// Each OLED screen is shown for 5 seconds, and redrawn (if it changed) every second.
 constexpr unsigned kOledSwitchMsec = 5000;
+constexpr unsigned kOledRefreshMsec = 1000;
+constexpr uint8_t kOledAddress = 0x3c;
+constexpr uint32_t kOledI2cHz = 400000;
+
+// History for /api/history: one averaged sample per minute for 24 hours (1440 x 24 bytes).
+constexpr size_t kHistorySamples = 24 * 60;
+constexpr unsigned kHistoryPeriodSec = 60;
+
+// Trace log in LittleFS for post-mortem analysis: 4 files of 24KB (about 12 hours of ticks
+//  at the default traceTickSec).  Staged records are written at least every 10 minutes.
+constexpr unsigned kTraceFiles = 4;
+constexpr size_t kTraceFileBytes = 24 * 1024;
+constexpr unsigned long kTraceMaxFlushDelayMsec = 10 * 60 * kMsecInSec;
+constexpr float kDefaultTraceTickSec = 15.0f;
+
+// Fermentation program, and the progress of a run, in LittleFS.  The progress is saved at
+//  every segment change and every kProgramSaveSec in between, so after a restart a run
+//  resumes at most this far back (or, once the clock is set by NTP, where it should be).
+constexpr char kProgramPath[] = "/program.json";
+constexpr char kProgramRunPath[] = "/program_run.bin";
+constexpr uint32_t kProgramSaveSec = 5 * 60;
+// time() values before this mean the clock has not been set.
+constexpr time_t kMinValidEpoch = 1700000000;
+
+#ifdef CONTROL_TIMING_LOG
+// Log control-loop stage timing after this many updates.
+constexpr unsigned kTimingLogUpdates = 600;
+#endif
 
 static const char kEnclosureTemperature[] = "enclosure_temp";
 static const char kRoomTemperature[] = "room_temp";
@@ -119,14 +233,20 @@ HAApp s_app(HAApp::Options(kManufacturer, kModel,
                                .withOta(OtaManager::Options(OTA_PASSWORD))
                                .withApp(App::Options().withLogType(kLogType))));
 
-// Have oled display IP address or AP status.
-OledWifiInfo wifi_infof(&s_app.tasks());
-
 VariableGroup s_vg("dough");
 VariableGroup s_cvg("dough_cfg");
 VariableGroup s_cmdvg("dough_cmd");
 
-DIn s_button_reader("power_button", &s_app.module_system(), kButtonPin, "power button", s_vg);
+// Press: toggle control.  Long press: cancel cooldown.  Double press: run the test command.
+ButtonEvents s_button({
+    .pin = kButtonPin,
+    .pressed_high = true,
+    .debounce_msec = kButtonDebounceMsec,
+    .long_press_msec = kButtonLongPressMsec,
+    .double_press_msec = kButtonDoublePressMsec,
+});
+// The debounced state of the button, as seen by s_button.
+BoolVariable s_power_button("power_button", false, "power button", 0, s_vg);
 
 // void onConfigLoad();
 
@@ -148,6 +268,81 @@ Shtc3 s_shtc3_enclosure(kEnclosureTemperature, kEnclosureHumidity, &s_app.module
 Shtc3 s_shtc3_room(kRoomTemperature, kRoomHumidity, &s_app.module_system(), "room temperature",
                    s_vg, true, true, &Wire1);
 
+// Sensor acquisition off the main loop.  On the device the task talks to the sensors directly,
+//  since the Shtc3 modules' variables belong to the main loop; the samples are copied into
+//  those variables by applySensorSample().
+#ifndef NATIVE
+SensorTask s_sensor_task(
+    {.period_msec = kSensorPeriodMsec, .retries = kSensorRetries},
+    [](float* temp, float* humidity) { return shtc3::measure(&Wire, temp, humidity); },
+    [](float* temp, float* humidity) { return shtc3::measure(&Wire1, temp, humidity); });
+#else
+bool readShtc3(Shtc3* sensor, float* temp, float* humidity) {
+  if (!sensor->read()) {
+    return false;
+  }
+  *temp = sensor->temperature();
+  *humidity = sensor->humidity();
+  return true;
+}
+SensorTask s_sensor_task(
+    {.period_msec = kSensorPeriodMsec, .retries = 0},
+    [](float* temp, float* humidity) { return readShtc3(&s_shtc3_enclosure, temp, humidity); },
+    [](float* temp, float* humidity) { return readShtc3(&s_shtc3_room, temp, humidity); });
+#endif
+
+// Copy a sample into the sensor modules' variables, which are what MQTT, HA and the web
+//  pages report.
+void applySensorSample(const SensorSample& sample) {
+  if (sample.enclosure_ok) {
+    s_shtc3_enclosure.temperatureVar() = sample.enclosure_temp;
+    s_shtc3_enclosure.humidityVar() = sample.enclosure_humidity;
+  }
+  if (sample.room_ok) {
+    s_shtc3_room.temperatureVar() = sample.room_temp;
+    s_shtc3_room.humidityVar() = sample.room_humidity;
+  }
+}
+
+#ifdef NATIVE
+namespace sim {
+// While a trace is replayed (--replay), sensor samples come from the trace, one per tick.
+bool s_replaying = false;
+bool s_replay_sample_ready = false;
+SensorSample s_replay_sample;
+}  // namespace sim
+#endif
+
+// True while the native build replays a trace, in place of the sensors and the main loop.
+bool replaying() {
+#ifdef NATIVE
+  return sim::s_replaying;
+#else
+  return false;
+#endif
+}
+
+SensorCache s_sensors(
+    [](SensorSample* sample) {
+#ifdef NATIVE
+      if (sim::s_replaying) {
+        *sample = sim::s_replay_sample;
+        return std::exchange(sim::s_replay_sample_ready, false);
+      }
+#endif
+      return s_sensor_task.poll(sample);
+    },
+    applySensorSample);
+FloatVariable s_sensor_max_age("sensorMaxAgeSec", kDefaultSensorMaxAgeSec, "sec",
+                               "Max sensor sample age",
+                               VariableBase::kSettable | VariableBase::kConfig, 1, s_cvg);
+
+// The latest sensor sample, for main-loop consumers other than the control tick.
+// Other tasks must use s_sensors.published() instead.
+const SensorSample& sensorSample() {
+  return s_sensors.get(millis(), static_cast<unsigned long>(s_sensor_max_age.value() * 1000));
+}
+
 Relay s_relay_fan(kFan, &s_app.tasks(), kRelayFanPin, "fan", true, s_vg);
 
 // PWM to regulate heater power
@@ -170,6 +365,33 @@ void heaterOff() {
   s_pwm_safety.setDutyF(0.0f);  // Disable the safety PWM signal.
 }
 
+#ifdef RECURSIVE_FILTER
+// Constant-cost filters.  tau is chosen for about the same noise reduction as the kernel
+//  filters below, estimated from a model of the kernel weighting rather than measured against
+//  og3's KernelFilter: run --filter-bench in the simulator to compare the two.
+RecursiveFilter s_temp_filter(
+    {
+        .name = kFilteredTemperature,
+        .units = units::kCelsius,
+        .description = "filtered enclosure temperature",
+        .var_flags = 0,
+        .tau = 4.6,
+        .stages = 2,
+        .decimals = 2,
+    },
+    &s_app.module_system(), s_vg);
+RecursiveFilter s_d_temp_filter(
+    {
+        .name = kFilteredDTemperature,
+        .units = "°C/sec",
+        .description = "filtered enclosure temperature change",
+        .var_flags = 0,
+        .tau = 3.4,
+        .stages = 2,
+        .decimals = 2,
+    },
+    &s_app.module_system(), s_vg);
+#else
 KernelFilter s_temp_filter(
     {
         .name = kFilteredTemperature,
@@ -192,8 +414,248 @@ KernelFilter s_d_temp_filter(
         .size = 15,
     },
     &s_app.module_system(), s_vg);
+#endif
+// The room temperature for the feedforward, which only has to follow the room.
+RecursiveFilter s_room_filter(
+    {
+        .name = "filteredRoomTemp",
+        .units = units::kCelsius,
+        .description = "filtered room temperature",
+        .var_flags = VariableBase::kNoPublish,
+        .tau = kRoomFilterTauSec,
+        .stages = 2,
+        .decimals = 2,
+    },
+    &s_app.module_system(), s_vg);
+
+OledPipeline s_oled(
+    {
+        .switch_msec = kOledSwitchMsec,
+        .refresh_msec = kOledRefreshMsec,
+        .address = kOledAddress,
+        .i2c_hz = kOledI2cHz,
+    },
+    &s_app.tasks());
+
+// Push the current status to web clients subscribed to /api/events.
+void sendStatusEvent();
+
+ControlHistory<kHistorySamples, kHistoryPeriodSec> s_history;
+
+TraceLog<> s_trace({
+    .dir = "/trace",
+    .num_files = kTraceFiles,
+    .file_bytes = kTraceFileBytes,
+    .max_flush_delay_msec = kTraceMaxFlushDelayMsec,
+});
+
+// With traceInputs set at boot, the trace also records what the control update depends on:
+//  the sensor sample and timing of each control tick, the commands the controller is given,
+//  and the config and fermentation program.  The native build replays such a trace through
+//  the same controller (see --replay in src/sim/sim_main.cpp).  Everything is recorded from
+//  the main loop, in the order the controller saw it.
+BoolVariable s_trace_inputs("traceInputs", false, "Trace control inputs (from restart)",
+                            VariableBase::kSettable | VariableBase::kConfig, s_cvg);
+bool s_tracing_inputs = false;  // traceInputs as it was at boot
+std::atomic<bool> s_trace_config_changed{false};
+
+void traceDocument(TraceDocumentKind kind, const JsonDocument& doc) {
+  std::vector<char> text(measureJson(doc) + 1);
+  const size_t len = serializeJson(doc, text.data(), text.size());
+  s_trace.addDocument(millis(), kind, text.data(), len);
+}
+
+void traceConfig() {
+  if (!s_tracing_inputs) {
+    return;
+  }
+  JsonDocument doc;
+  for (VariableGroup* vg : {&s_cvg, &s_cmdvg}) {
+    JsonObject json = doc[vg->name()].to<JsonObject>();
+    vg->toJson(json, VariableBase::kConfig);
+  }
+  traceDocument(kTraceConfig, doc);
+}
+
+void traceProgram(const FermentProgram& program) {
+  if (!s_tracing_inputs) {
+    return;
+  }
+  JsonDocument doc;
+  program.toJson(doc.to<JsonObject>());
+  traceDocument(kTraceProgram, doc);
+}
+
+void traceCommand(TraceCommandId id, float value = 0.0f, uint32_t param = 0) {
+  if (!s_tracing_inputs) {
+    return;
+  }
+  const SensorSample& sample = s_sensors.sample();
+  const TraceCommand command = {
+      .value = value,
+      .param = param,
+      .sample_msec = sample.msec,
+      .enclosure_temp = sample.enclosure_temp,
+      .enclosure_ok = sample.enclosure_ok,
+      .reserved = {},
+  };
+  s_trace.addCommand(millis(), id, command);
+}
+
+// Record the inputs of a control tick, after the sensor cache has been refreshed.  A config
+//  change is recorded first, so a replay applies it before the update which used it.
+void traceInput(unsigned long deadline_msec, uint32_t periods) {
+  if (!s_tracing_inputs) {
+    return;
+  }
+  if (s_trace_config_changed.exchange(false)) {
+    traceConfig();
+  }
+  const SensorSample& sample = s_sensors.sample();
+  const unsigned long now_msec = millis();
+  const TraceInput input = {
+      .enclosure_temp = sample.enclosure_temp,
+      .room_temp = sample.room_temp,
+      .enclosure_humidity = sample.enclosure_humidity,
+      .room_humidity = sample.room_humidity,
+      .sample_msec = sample.msec,
+      .late_msec = static_cast<uint16_t>(std::min<unsigned long>(now_msec - deadline_msec, 0xffff)),
+      .periods = static_cast<uint8_t>(std::min<uint32_t>(periods, 0xff)),
+      .flags = static_cast<uint8_t>((sample.enclosure_ok ? TraceInput::kEnclosureOk : 0) |
+                                    (sample.room_ok ? TraceInput::kRoomOk : 0)),
+  };
+  s_trace.addInput(now_msec, input);
+}
+
+// Binary snapshot of s_cvg and s_cmdvg, read at boot in place of their JSON files.
+ConfigSnapshot s_config_snapshot("/config.bin");
+
+// Coalesced config writes: call saveConfig() after changing a config group.
+// When s_cvg or s_cmdvg is written the snapshot is rewritten first, and then the JSON files,
+//  so a snapshot which passes its CRC at boot is never older than the JSON.
+ConfigPersister s_config_persister(
+    {.quiet_msec = kConfigQuietMsec, .max_delay_msec = kConfigMaxDelayMsec},
+    [](VariableGroup& vg) { s_app.config().write_config(vg); },
+    [](uint32_t groups) {
+#ifndef NATIVE
+      if (s_config_persister.writes(groups, s_cvg) || s_config_persister.writes(groups, s_cmdvg)) {
+        s_config_snapshot.save();
+      }
+#endif
+    });
+void saveConfig(const VariableGroup& vg) {
+  s_config_persister.markDirty(vg, millis());
+  if (&vg == &s_cvg || &vg == &s_cmdvg) {
+    s_trace_config_changed = true;
+  }
+}
+
+// Wall-clock seconds, or 0 if the clock has not been set.
+uint32_t epochSec() {
+#ifndef NATIVE
+  const time_t now = time(nullptr);
+  return now >= kMinValidEpoch ? static_cast<uint32_t>(now) : 0;
+#else
+  return 0;
+#endif
+}
+
+bool writeProgramFile(const FermentProgram& program) {
+#ifndef NATIVE
+  JsonDocument doc;
+  program.toJson(doc.to<JsonObject>());
+  String text;
+  serializeJson(doc, text);
+  File file = LittleFS.open(kProgramPath, "w");
+  if (!file) {
+    return false;
+  }
+  const bool ok =
+      text.length() == file.write(reinterpret_cast<const uint8_t*>(text.c_str()), text.length());
+  file.close();
+  return ok;
+#else
+  return true;
+#endif
+}
+
+bool readProgramFile(FermentProgram* program) {
+#ifndef NATIVE
+  File file = LittleFS.open(kProgramPath, "r");
+  if (!file) {
+    return false;
+  }
+  std::vector<uint8_t> text(file.size());
+  const bool ok = text.size() == file.read(text.data(), text.size());
+  file.close();
+  JsonDocument doc;
+  return ok &&
+         !deserializeJson(doc, reinterpret_cast<const char*>(text.data()), text.size()) &&
+         !program->fromJson(doc.as<JsonObject>(), kTargetTempMin, kTargetTempMax);
+#else
+  return false;
+#endif
+}
+
+bool writeProgramRun(const FermentProgram::RunState& state) {
+#ifndef NATIVE
+  File file = LittleFS.open(kProgramRunPath, "w");
+  if (!file) {
+    return false;
+  }
+  const bool ok =
+      sizeof(state) == file.write(reinterpret_cast<const uint8_t*>(&state), sizeof(state));
+  file.close();
+  return ok;
+#else
+  return true;
+#endif
+}
+
+bool readProgramRun(FermentProgram::RunState* state) {
+#ifndef NATIVE
+  File file = LittleFS.open(kProgramRunPath, "r");
+  if (!file) {
+    return false;
+  }
+  const bool ok = sizeof(*state) == file.read(reinterpret_cast<uint8_t*>(state), sizeof(*state));
+  file.close();
+  return ok && state->valid();
+#else
+  return false;
+#endif
+}
+
+void removeProgramRun() {
+#ifndef NATIVE
+  if (LittleFS.exists(kProgramRunPath)) {
+    LittleFS.remove(kProgramRunPath);
+  }
+#endif
+}
+
+// Runtime performance counters for /api/perf.
+PerfCounters s_perf;
+
+// Commands from MQTT, parsed in the MQTT client's task and applied by the control tick.
+MqttCommandRouter s_mqtt_commands;
 
-OledDisplayRing s_oled(&s_app.module_system(), "DoughL33", kOledSwitchMsec, Oled::kTenPt);
+HaAnnouncer s_ha_announcer(
+    {
+        .pace_msec = kHaAnnouncePaceMsec,
+        .max_delay_msec = kHaAnnounceMaxDelayMsec,
+    },
+    &s_app.tasks());
+size_t mqttPayloadBytes(const VariableGroup& vg, unsigned flags);
+
+// Sends s_vg, s_cvg and s_cmdvg over MQTT when their values change, rather than every tick.
+MqttChangePublisher s_mqtt_publisher(
+    [](const VariableGroup& vg, unsigned flags) {
+      s_app.mqttSend(vg, flags);
+      s_perf.addMqttSend(mqttPayloadBytes(vg, flags));
+      return true;
+    },
+    []() { return s_app.mqtt_manager().isConnected(); });
 
 class TempControl : public Module {
  public:
@@ -203,6 +665,7 @@ class TempControl : public Module {
     kStateCooldown,  // run fan after heating to cooldown
     kStateError,     // a problem was detected.
     kStateCommand,   // constant-output test state (m_test_command)
+    kStateAutotune,  // relay-feedback experiment to find PID gains
   };
 
   static const char* state_names[];
@@ -214,7 +677,8 @@ class TempControl : public Module {
   TempControl()
       : Module("temp_ctl", &s_app.module_system()),
         m_scheduler(&s_app.tasks()),
-        m_state("state", kStateDisabled, "heater state", kStateCommand, state_names, kNoFlag, s_vg),
+        m_state("state", kStateDisabled, "heater state", kStateAutotune, state_names, kNoFlag,
+                s_vg),
         m_temp_min_ok("tempMinOk", kDefaultMinValidTemp, units::kCelsius, "Min valid temperature",
                       kCfgFlag, 1, s_cvg),
         m_temp_max_ok("tempMaxOk", kDefaultMaxValidTemp, units::kCelsius, "Max valid temperature",
@@ -230,26 +694,122 @@ class TempControl : public Module {
         m_test_command_time("testCommandSec", 0.0f, "sec", "Test command sec", kCfgFlag, 1,
                             s_cmdvg),
         m_heat_mode("heatMode", kOff, "", "heater mode", kNoFlag, s_vg),
-        m_fan_mode("fanMode", kOff, "", "fan mode", kNoFlag, s_vg) {
+        m_fan_mode("fanMode", kOff, "", "fan mode", kNoFlag, s_vg),
+        m_mqtt_temp_deadband("mqttTempDeadband", kDefaultMqttTempDeadband, units::kCelsius,
+                             "MQTT temperature deadband", kCfgFlag, 2, s_cvg),
+        m_mqtt_humidity_deadband("mqttHumidityDeadband", kDefaultMqttHumidityDeadband, "%",
+                                 "MQTT humidity deadband", kCfgFlag, 1, s_cvg),
+        m_mqtt_duty_deadband("mqttDutyDeadband", kDefaultMqttDutyDeadband, "pwm",
+                             "MQTT heater deadband", kCfgFlag, 3, s_cvg),
+        m_mqtt_keepalive_sec("mqttKeepaliveSec", kDefaultMqttKeepaliveSec, "sec",
+                             "MQTT keepalive", kCfgFlag, 0, s_cvg),
+        m_trace_tick_sec("traceTickSec", kDefaultTraceTickSec, "sec", "Trace log tick period",
+                         kCfgFlag, 0, s_cvg),
+        m_autotune_output("autotuneOutput", kDefaultAutotuneOutput, "pwm", "Autotune heater output",
+                          kCfgFlag, 2, s_cvg),
+        m_autotune_hysteresis("autotuneHysteresis", kDefaultAutotuneHysteresis, units::kCelsius,
+                              "Autotune hysteresis", kCfgFlag, 2, s_cvg),
+        m_autotune_apply("autotuneApply", false, "Apply autotuned gains", kCfgFlag, s_cvg),
+        m_autotune_ku("autotuneKu", 0.0f, "pwm/°C", "Autotune ultimate gain",
+                      VariableBase::kNoPublish, 3, s_vg),
+        m_autotune_tu("autotuneTu", 0.0f, "sec", "Autotune ultimate period",
+                      VariableBase::kNoPublish, 0, s_vg),
+        m_autotune_p("autotuneP", 0.0f, "pwm/°C", "Autotuned kP", VariableBase::kNoPublish, 4,
+                     s_vg),
+        m_autotune_i("autotuneI", 0.0f, "pwm/(°C*s)", "Autotuned kI", VariableBase::kNoPublish,
+                     6, s_vg),
+        m_autotune_d("autotuneD", 0.0f, "pwm/(°C/s)", "Autotuned kD", VariableBase::kNoPublish,
+                     2, s_vg),
+        m_ff_adaptive("ffAdaptive", false, "Feedforward from thermal model", kCfgFlag, s_cvg),
+        m_ff_model_forgetting("ffModelForgetting", kDefaultFFModelForgetting, "",
+                              "Thermal model forgetting factor", kCfgFlag, 3, s_cvg),
+        m_ff_model_per_delta_c("ffModelPerDeltaC", 0.0f, "pwm/deltaC", "Model FF per deltaC",
+                               VariableBase::kNoPublish, 4, s_vg),
+        m_ff_model_per_delta_c_sd("ffModelPerDeltaCSd", 0.0f, "pwm/deltaC",
+                                  "Model FF per deltaC stddev", VariableBase::kNoPublish, 4,
+                                  s_vg),
+        m_ff_model_per_rate("ffModelPerRate", 0.0f, "pwm/(°C/s)", "Model FF per rate",
+                            VariableBase::kNoPublish, 2, s_vg),
+        m_ff_model_per_rate_sd("ffModelPerRateSd", 0.0f, "pwm/(°C/s)", "Model FF per rate stddev",
+                               VariableBase::kNoPublish, 2, s_vg),
+        m_program_running("programRunning", false, "Program running", 0, s_vg),
+        m_program_segment("programSegment", 0, "", "Program segment", 0, s_vg),
+        m_program_set_temp("programSetTemp", 0.0f, units::kCelsius, "Program setpoint", 0, 1,
+                           s_vg),
+        m_program_remaining_min("programRemainingMin", 0.0f, "min", "Program time remaining", 0,
+                                0, s_vg),
+        m_ff_track_room("ffTrackRoom", true, "Feedforward follows room temperature", kCfgFlag,
+                        s_cvg),
+        m_ff_reference_temp("ffReferenceTemp", 0.0f, units::kCelsius, "Feedforward reference",
+                            VariableBase::kNoPublish, 2, s_vg),
+        m_room_failures("roomSensorFailures", 0, "", "Room sensor failures",
+                        VariableBase::kNoPublish, s_vg),
+        m_ff_reference({.max_slew = kFFReferenceSlew}),
+        m_thermal_model({
+            .period_msec = kThermalModelPeriodMsec,
+            .min_updates = kThermalModelMinUpdates,
+            .max_rel_stddev = kThermalModelMaxRelStddev,
+        }) {
     add_init_fn([this]() {
-      s_oled.addDisplayFn([this]() { show_state(); });
+      m_oled_screen = s_oled.addDisplayFn([this]() { show_state(); });
+      addMqttWatches();
       auto* had = &s_app.ha_discovery();
-      had->addDiscoveryCallback([this](HADiscovery* had, JsonDocument* json) -> bool {
-        return this->haDiscovery(had, json);
-      });
-      had->addDiscoveryCallback([this](HADiscovery* had, JsonDocument* json) {
-        return had->addEnum(json, m_state, ha::device_type::kSensor, nullptr);
-      });
-      had->addDiscoveryCallback([this](HADiscovery* had, JsonDocument* json) {
-        return had->addBinarySensor(json, s_relay_fan.isHighVar(),
-                                    ha::device_class::binary_sensor::kRunning);
-      });
+      auto& ann = s_ha_announcer;
+      ann.add(
+          had,
+          [this, had]() {
+            const std::vector<uint8_t>& entry = climateDiscovery(had);
+            return HaAnnouncer::hash(entry.data(), entry.size());
+          },
+          [this](HADiscovery* had, JsonDocument* json) { return haDiscovery(had, json); });
+      ann.add(had, HaAnnouncer::inputsHash(had, m_state, ha::device_type::kSensor, nullptr),
+              [this](HADiscovery* had, JsonDocument* json) {
+                return had->addEnum(json, m_state, ha::device_type::kSensor, nullptr);
+              });
+      ann.add(had,
+              HaAnnouncer::inputsHash(had, s_relay_fan.isHighVar(), nullptr,
+                                      ha::device_class::binary_sensor::kRunning),
+              [](HADiscovery* had, JsonDocument* json) {
+                return had->addBinarySensor(json, s_relay_fan.isHighVar(),
+                                            ha::device_class::binary_sensor::kRunning);
+              });
+      ann.add(had,
+              HaAnnouncer::inputsHash(had, m_program_running, nullptr,
+                                      ha::device_class::binary_sensor::kRunning),
+              [this](HADiscovery* had, JsonDocument* json) {
+                return had->addBinarySensor(json, m_program_running,
+                                            ha::device_class::binary_sensor::kRunning);
+              });
+      ann.add(had,
+              HaAnnouncer::inputsHash(had, m_program_set_temp, ha::device_type::kSensor,
+                                      ha::device_class::sensor::kTemperature),
+              [this](HADiscovery* had, JsonDocument* json) {
+                return had->addMeas(json, m_program_set_temp, ha::device_type::kSensor,
+                                    ha::device_class::sensor::kTemperature);
+              });
+      ann.add(had,
+              HaAnnouncer::inputsHash(had, m_program_segment, ha::device_type::kSensor, nullptr),
+              [this](HADiscovery* had, JsonDocument* json) {
+                return had->addMeas(json, m_program_segment, ha::device_type::kSensor, nullptr);
+              });
+      ann.add(had,
+              HaAnnouncer::inputsHash(had, m_program_remaining_min, ha::device_type::kSensor,
+                                      nullptr),
+              [this](HADiscovery* had, JsonDocument* json) {
+                return had->addMeas(json, m_program_remaining_min, ha::device_type::kSensor,
+                                    nullptr);
+              });
     });  // end of init-fn
   }
 
-  void setTargetTemp(float target) { m_set_temp = target; }
+  void setTargetTemp(float target) {
+    traceCommand(kTraceSetTemp, target);
+    m_set_temp = target;
+  }
 
   bool enabled() const { return m_state.value() == kStateEnabled; }
+  State state() const { return m_state.value(); }
+  float setTemp() const { return m_set_temp.value(); }
 
   void setEnable() {
     // Enable control from current state.
@@ -260,12 +820,15 @@ class TempControl : public Module {
       case kStateCooldown:
       case kStateError:
       case kStateCommand:
+      case kStateAutotune:
         // Make sure feedforward temperature will be recomputed if control is re-enabled.
         m_initial_temp = kUninitializedTemp;
+        m_ff_reference.reset();
         s_pid.feedforward() = 0.0f;
-        // Start ramping from current temperature
-        if (s_shtc3_enclosure.read()) {
-          s_pid.target() = s_shtc3_enclosure.temperature();
+        // Start ramping from current temperature, as cached, so a trace replay sees the same.
+        const SensorSample& sample = s_sensors.sample();
+        if (sample.enclosure_ok) {
+          s_pid.target() = sample.enclosure_temp;
           s_pid.d_target() = 0.0f;
         } else {
           s_pid.target() = m_set_temp.value();
@@ -281,6 +844,7 @@ class TempControl : public Module {
     switch (m_state.value()) {
       case kStateEnabled:
       case kStateCommand:
+      case kStateAutotune:
         setState(kStateCooldown, 100);
         break;
       case kStateDisabled:
@@ -300,23 +864,213 @@ class TempControl : public Module {
       s_app.log().log("Enabling temperature control.");
       setEnable();
     }
-    show_state();  // show on OLED
+    s_oled.select(m_oled_screen);
+  }
+
+  void onButton(ButtonEvents::Event event) {
+    traceCommand(kTraceButton, 0.0f, event);
+    switch (event) {
+      case ButtonEvents::kPress:
+        s_app.log().log("button -> press");
+        toggleEnable();
+        break;
+      case ButtonEvents::kLongPress:
+        s_app.log().log("button -> long press");
+        if (m_state.value() == kStateCooldown || m_state.value() == kStateError) {
+          s_app.log().log("Cooldown cancelled.");
+          setState(kStateDisabled, kUpdateOffMsec);
+          turnFanOff();
+          s_oled.select(m_oled_screen);
+        }
+        break;
+      case ButtonEvents::kDoublePress:
+        s_app.log().log("button -> double press");
+        if (m_state.value() == kStateDisabled) {
+          delaySetTestCommand();
+        }
+        break;
+    }
   }
 
   void delaySetEnable(bool enable) {
+    m_scheduler.runIn(1, [this, enable]() { enableCommand(enable); });
+  }
+  void enableCommand(bool enable) {
     if (!enable && enabled()) {
-      m_scheduler.runIn(1, [this]() { setDisable(); });
+      traceCommand(kTraceEnable, 0.0f);
+      setDisable();
     } else if (enable && !enabled()) {
-      m_scheduler.runIn(1, [this]() { setEnable(); });
+      traceCommand(kTraceEnable, 1.0f);
+      setEnable();
     }
   }
 
+  // Apply a command from s_mqtt_commands, in the control tick.  The fields of a batch are
+  //  applied together: target and fan before the mode, so heating starts at the new target.
+  void applyCommand(const MqttCommand& command) {
+    if (command.fields & MqttCommand::kSetTemp) {
+      if (command.set_temp > kTargetTempMax || command.set_temp < kTargetTempMin) {
+        s_app.log().logf("MQTT set_temp %g out of range.", command.set_temp);
+      } else {
+        setTargetTemp(command.set_temp);
+      }
+    }
+    if (command.fields & MqttCommand::kFanMode) {
+      setFanMode(command.fan_high);
+    }
+    if (command.fields & MqttCommand::kMode) {
+      enableCommand(command.enable);
+    }
+    if (command.fields & MqttCommand::kProgram) {
+      if (command.program_start) {
+        startProgram();
+      } else {
+        cancelProgram();
+      }
+    }
+  }
+
+  // The delay*() methods may be called from any task: they run the command in the main loop.
+  //  The commands are traced for replay (see traceInputs).
   void delaySetTestCommand() {
-    m_scheduler.runIn(1, [this]() { setState(kStateCommand, kUpdateOnMsec); });
+    m_scheduler.runIn(1, [this]() { startTestCommand(); });
+  }
+  void startTestCommand() {
+    traceCommand(kTraceTestCommand);
+    setState(kStateCommand, kUpdateOnMsec);
   }
 
-  void setFanOn() { mqttSetFanMode("api", kHigh, strlen(kHigh)); }
-  void setFanOff() { mqttSetFanMode("api", kOff, strlen(kOff)); }
+  // Start a relay autotune experiment around the set temperature.
+  void delayStartAutotune() {
+    m_scheduler.runIn(1, [this]() { startAutotune(); });
+  }
+  void startAutotune() {
+    traceCommand(kTraceAutotune);
+    s_app.log().logf("Autotune around %.1fC, output %.2f, hysteresis %.2fC.", m_set_temp.value(),
+                     m_autotune_output.value(), m_autotune_hysteresis.value());
+    m_autotune.start(
+        {
+            .setpoint = m_set_temp.value(),
+            .output_high = m_autotune_output.value(),
+            .output_low = 0.0f,
+            .hysteresis = m_autotune_hysteresis.value(),
+            .cycles = kAutotuneCycles,
+            .max_msec = kAutotuneMaxMsec,
+        },
+        millis());
+    setState(kStateAutotune, kUpdateOnMsec);
+  }
+
+  // Replace the fermentation program, stopping any run of the old one.
+  void setProgram(const FermentProgram& program) {
+    traceProgram(program);
+    if (m_program.running()) {
+      stopProgram();
+    }
+    m_program = program;
+    if (!writeProgramFile(m_program)) {
+      s_app.log().log("Failed to write fermentation program.");
+    }
+  }
+
+  // Run the fermentation program from its start, from the current enclosure temperature.
+  void delayStartProgram() {
+    m_scheduler.runIn(1, [this]() { startProgram(); });
+  }
+  void startProgram() {
+    traceCommand(kTraceProgramStart);
+    const SensorSample& sample = s_sensors.sample();
+    const float start_temp = sample.enclosure_ok ? sample.enclosure_temp : m_set_temp.value();
+    if (!m_program.start(start_temp, 0, millis())) {
+      s_app.log().log("No fermentation program to start.");
+      return;
+    }
+    s_app.log().logf("Starting program '%s': %u segments, %.0f min.", m_program.name(),
+                     m_program.numSegments(), m_program.totalSec() / 60.0f);
+    m_resume_epoch_sec = 0;
+    m_program_running = true;
+    m_program_segment = 0;
+    saveProgramRun(millis());
+    setEnable();
+    s_oled.select(m_oled_screen);
+  }
+
+  // Stop the program: control continues at setTemp.
+  void delayStopProgram() {
+    m_scheduler.runIn(1, [this]() { cancelProgram(); });
+  }
+  void cancelProgram() {
+    traceCommand(kTraceProgramStop);
+    if (m_program.running()) {
+      s_app.log().logf("Stopping program '%s'.", m_program.name());
+      stopProgram();
+    }
+  }
+
+  // At boot: load the program, and resume its run if one was in progress.
+  void loadProgram() {
+    if (!readProgramFile(&m_program)) {
+      return;
+    }
+    FermentProgram::RunState run;
+    if (!readProgramRun(&run) || run.program_crc != m_program.crc()) {
+      return;
+    }
+    traceProgram(m_program);
+    resumeProgram(run.start_temp, run.elapsed_sec, run.epoch_sec);
+    delaySetEnable(true);
+  }
+  // Resume a run elapsed_sec into the program.  epoch_sec is when the run was saved, if known.
+  void resumeProgram(float start_temp, uint32_t elapsed_sec, uint32_t epoch_sec) {
+    traceCommand(kTraceProgramResume, start_temp, elapsed_sec);
+    m_program.start(start_temp, elapsed_sec, millis());
+    m_resume_epoch_sec = epoch_sec;
+    m_resume_elapsed_sec = elapsed_sec;
+    m_program_saved_sec = elapsed_sec;
+    m_program_running = true;
+    s_app.log().logf("Resuming program '%s' at %.0f of %.0f min.", m_program.name(),
+                     elapsed_sec / 60.0f, m_program.totalSec() / 60.0f);
+  }
+
+  // Once the wall clock is set, move a resumed run on by the time the device was off since the
+  //  run was saved.  Called by the control tick before the inputs are traced, so a replay
+  //  applies the skip before the same update.
+  void checkProgramClock() {
+    const uint32_t epoch_sec = m_program.running() && m_resume_epoch_sec ? epochSec() : 0;
+    if (epoch_sec <= m_resume_epoch_sec) {
+      return;
+    }
+    const uint32_t counted_sec = m_program.elapsedSec(millis()) - m_resume_elapsed_sec;
+    const uint32_t since_save_sec = epoch_sec - m_resume_epoch_sec;
+    if (since_save_sec > counted_sec) {
+      skipProgram(since_save_sec - counted_sec);
+    }
+    m_resume_epoch_sec = 0;
+  }
+  void skipProgram(uint32_t sec) {
+    traceCommand(kTraceProgramSkip, 0.0f, sec);
+    s_app.log().logf("Program: skipping %u sec while off.", sec);
+    m_program.skip(sec);
+  }
+
+  const FermentProgram& program() const { return m_program; }
+  // The temperature control is heading for: the program's setpoint while one runs.
+  float goalTemp() const {
+    return m_program.running() ? m_program_set_temp.value() : m_set_temp.value();
+  }
+
+  void setFanOn() { m_scheduler.runIn(1, [this]() { setFanMode(true); }); }
+  void setFanOff() { m_scheduler.runIn(1, [this]() { setFanMode(false); }); }
+  void setFanMode(bool high) {
+    traceCommand(kTraceFanMode, 0.0f, high ? 1 : 0);
+    if (high) {
+      m_fan_mode = kHigh;
+      turnFanOn();
+    } else {
+      m_fan_mode = kOff;
+      turnFanOff();
+    }
+  }
 
   long msecInState() const { return millis() - m_last_state_change_msec; }
   float initialTemp() const { return m_initial_temp; }
@@ -332,35 +1086,71 @@ class TempControl : public Module {
   }
   void turnFanOn() { s_relay_fan.turnOn(); }
 
+  // Called by s_oled every refresh while this screen is shown; it only redraws on a change.
+  //  Uses the control tick's sample rather than reading the sensors.
   void show_state() {
-    char display[80];
+    char display[OledPipeline::kMaxText];
     const State state = m_state.value();
-    s_shtc3_enclosure.read();
+    const float temp = sensorSample().enclosure_temp;
     if (state == kStateEnabled) {
-      snprintf(display, sizeof(display), "%s\n%.1f -> %.1f", state_names[m_state.value()],
-               s_shtc3_enclosure.temperature(), s_pid.target().value());
-      s_oled.setFontSize(Oled::kTenPt);
+      snprintf(display, sizeof(display), "%s\n%.1f -> %.1f", state_names[m_state.value()], temp,
+               s_pid.target().value());
+      s_oled.setFontSize(OledPipeline::kTenPt);
     } else {
-      snprintf(display, sizeof(display), "%s %.1f C", state_names[m_state.value()],
-               s_shtc3_enclosure.temperature());
-      s_oled.setFontSize(Oled::kSixteenPt);
+      snprintf(display, sizeof(display), "%s %.1f C", state_names[m_state.value()], temp);
+      s_oled.setFontSize(OledPipeline::kSixteenPt);
     }
     s_oled.display(display);
   }
 
-  void update() {
-    if (!s_shtc3_enclosure.read() && m_state.value() != kStateDisabled) {
+  // Called by the control ticker with the tick's deadline, and the number of tick periods
+  //  since the previous call.  update() runs when the delay asked for by the last
+  //  setState() / sameState() has passed.
+  void onTick(unsigned long deadline_msec, uint32_t periods) {
+    if (periods > 1) {
+      s_app.log().logf("Control tick overrun: %u ticks missed.", periods - 1);
+    }
+    if (m_ticks_to_update > periods) {
+      m_ticks_to_update -= periods;
+      return;
+    }
+    update(deadline_msec);
+  }
+
+  // Run the control update.  now_msec is the tick's deadline, so that time steps are exact
+  //  multiples of the tick period however late the main loop gets to it.
+  void update(unsigned long now_msec) {
+    m_timing.start();
+    // The control tick has just refreshed the sensor cache.
+    const SensorSample& sample = s_sensors.sample();
+    const bool sample_fresh = s_sensors.ageMsec(millis()) <= kMaxSensorAgeMsec;
+    if (!(sample_fresh && sample.enclosure_ok) && m_state.value() != kStateDisabled) {
       s_app.log().logf("Failed to read SHTC3 enclosure sensor");
       setState(kStateError, 10 * kMsecInSec);
     }
-    if (!s_shtc3_room.read()) {
-      static bool s_warned = false;  // Not yet working, so only warn once.
-      if (!s_warned) {
-        s_app.log().logf("Failed to read SHTC3 room sensor");
-        s_warned = true;
+    // The room sensor is optional: without it the feedforward falls back (see ffReference()).
+    const bool room_ok = sample_fresh && sample.room_ok;
+    if (room_ok != m_room_ok || !m_room_logged) {
+      if (!room_ok) {
+        m_room_failures = m_room_failures.value() + 1;
+        s_app.log().logf("Failed to read SHTC3 room sensor (%u times).", m_room_failures.value());
+      } else if (m_room_logged) {
+        s_app.log().log("SHTC3 room sensor working again.");
       }
+      m_room_ok = room_ok;
+      m_room_logged = true;
+    }
+    if (m_room_ok) {
+      s_room_filter.addSample(now_msec * 1e-3f, sample.room_temp);
     }
-    const long now_msec = millis();
+    m_timing.mark(ControlTiming::kSensors);
+    // Track the cadence of the 1-second control tick as actually run.
+    const unsigned long run_msec = millis();
+    if (m_state.value() == kStateEnabled && m_last_update_state == kStateEnabled) {
+      m_timing.addInterval(run_msec - m_last_update_msec);
+    }
+    m_last_update_msec = run_msec;
+    m_last_update_state = m_state.value();
     const float temp = s_shtc3_enclosure.temperature();
     const bool temp_ok = temp >= m_temp_min_ok.value() && temp <= m_temp_max_ok.value();
     const float now_sec = now_msec * 1e-3;
@@ -371,10 +1161,13 @@ class TempControl : public Module {
       setState(kStateError, 10 * kMsecInSec);
     }
 
+    const float set_temp = updateProgram(now_msec);
+
     // Store the enclosure temperature when control is first enabled.
     if (m_state.value() == kStateEnabled && m_initial_temp == kUninitializedTemp) {
       m_initial_temp = temp;
     }
+    const float ff_ref_temp = ffReference(now_msec);
 
     // Return a target d_temp of -ramp_rate or ramp_rate, unless within a degree of them
     //  target, in which case scale ramp linearly to zero when error is zero.
@@ -389,25 +1182,34 @@ class TempControl : public Module {
     // Ramping and Feedforward Logic
     if (m_state.value() == kStateEnabled && m_last_msec > 0) {
       const float dt = (now_msec - m_last_msec) * 1.0e-3;
-      if (dt > 0.0f && dt < 2.0f) {  // Sanity check on dt
+      if (dt > 0.0f && dt <= kMaxRampDtSec) {  // Sanity check on dt
         const float current_target = s_pid.target().value();
-        const float target_d_temp = compute_target_d_temp(m_set_temp.value(), current_target);
+        const float target_d_temp = compute_target_d_temp(set_temp, current_target);
         const float delta_target = target_d_temp * dt;
-        const bool is_close = std::abs(m_set_temp.value() - current_target) < 0.05;
-        const float next_target = is_close ? m_set_temp.value() : current_target + delta_target;
+        const bool is_close = std::abs(set_temp - current_target) < 0.05;
+        const float next_target = is_close ? set_temp : current_target + delta_target;
         s_pid.target() = next_target;
         s_pid.d_target() = compute_target_d_temp(next_target, temp);
 
-        // Calculate Feedforward
+        // Calculate Feedforward, from the thermal model's estimates if enabled and trusted.
+        const bool adaptive = m_ff_adaptive.value();
+        const float ff_per_rate = adaptive && m_thermal_model.ffPerRateOk()
+                                      ? m_thermal_model.ffPerRate()
+                                      : m_ff_per_rate.value();
+        const float ff_per_delta_c = adaptive && m_thermal_model.ffPerDeltaCOk()
+                                         ? m_thermal_model.ffPerDeltaC()
+                                         : m_ctl_ff_per_delta_c.value();
+
         // 1. Dynamic FF: Power required to change temperature (Heat Capacity)
-        const float dynamic_ff = target_d_temp * m_ff_per_rate.value();
+        const float dynamic_ff = target_d_temp * ff_per_rate;
 
         // 2. Static FF: Power required to maintain delta T (Insulation Loss)
-        const float static_ff = (next_target - m_initial_temp) * m_ctl_ff_per_delta_c.value();
+        const float static_ff = (next_target - ff_ref_temp) * ff_per_delta_c;
 
         s_pid.feedforward() = static_ff + dynamic_ff;
       }
     }
+    m_timing.mark(ControlTiming::kRamp);
 
     // Track filtered temperature and temperature derivatives.
     float filt_d_temp = 0.0f;
@@ -422,6 +1224,7 @@ class TempControl : public Module {
       m_last_temp = temp;
       m_last_msec = now_msec;
     }
+    m_timing.mark(ControlTiming::kFilters);
 
     switch (m_state.value()) {
       case kStateDisabled:
@@ -447,11 +1250,24 @@ class TempControl : public Module {
         break;
       case kStateEnabled: {
         const float cmd = s_pid.command(temp, filt_d_temp, now_msec);
+        m_timing.mark(ControlTiming::kPid);
         heaterOn(cmd);
         turnFanOn();
         sameState(kUpdateOnMsec);
         break;
       }
+      case kStateAutotune: {
+        const float cmd = m_autotune.update(now_msec, s_temp_filter.value());
+        if (m_autotune.running()) {
+          heaterOn(cmd);
+          turnFanOn();
+          sameState(kUpdateOnMsec);
+        } else {
+          heaterOff();
+          finishAutotune();
+        }
+        break;
+      }
       case kStateCommand: {
         const int test_command_msec = static_cast<int>(testCommandTime() * 1e3);
         if (test_command_msec <= 0 || msecInState() < test_command_msec) {
@@ -472,33 +1288,94 @@ class TempControl : public Module {
         break;
       }
     }
+    m_timing.mark(ControlTiming::kOutputs);
+
+    // Learn the feedforward coefficients while the heater is under control.
+    if (temp_ok && (m_state.value() == kStateEnabled || m_state.value() == kStateAutotune)) {
+      m_thermal_model.add(now_msec, s_temp_filter.value(), ff_ref_temp,
+                          s_pwm_heater.dutyF(), m_ff_model_forgetting.value());
+      m_ff_model_per_delta_c = m_thermal_model.ffPerDeltaC();
+      m_ff_model_per_delta_c_sd = m_thermal_model.ffPerDeltaCStddev();
+      m_ff_model_per_rate = m_thermal_model.ffPerRate();
+      m_ff_model_per_rate_sd = m_thermal_model.ffPerRateStddev();
+    }
 
-    s_app.mqttSend(s_vg);
-    // Send config variables unless marked kNoPublish.
-    s_app.mqttSend(s_cvg, VariableBase::kNoPublish | VariableBase::kConfig);
-    s_app.mqttSend(s_cmdvg, VariableBase::kConfig);
+    const HistoryInput history_input = historyInput();
+    s_history.add(now_msec, history_input);
+    // Ticks are traced every traceTickSec (0 disables them); state changes are always traced.
+    const unsigned long trace_tick_msec = m_trace_tick_sec.value() * kMsecInSec;
+    if (trace_tick_msec > 0 && now_msec - m_last_trace_msec >= trace_tick_msec) {
+      s_trace.addTick(now_msec, history_input);
+      m_last_trace_msec = now_msec;
+    }
+    s_trace.poll(now_msec);
+
+    s_mqtt_publisher.publish(now_msec,
+                             static_cast<unsigned long>(m_mqtt_keepalive_sec.value() * kMsecInSec));
+    m_timing.mark(ControlTiming::kMqtt);
+    sendStatusEvent();
+    m_timing.finish();
+#ifdef CONTROL_TIMING_LOG
+    if (m_timing.stage(ControlTiming::kTotal).count() >= kTimingLogUpdates) {
+      logTiming();
+      m_timing.clear();
+    }
+#endif
   }
 
-  void writeHtmlStatusTable(String* out) {
-    html::writeTableStart(out, "Status");
-    html::writeRowInto(out, s_pid.target());
-    html::writeRowInto(out, m_heat_mode);
-    html::writeRowInto(out, m_fan_mode);
-    html::writeRowInto(out, s_relay_fan.isHighVar());
-    html::writeRowInto(out, s_shtc3_enclosure.temperatureVar());
-    html::writeRowInto(out, s_shtc3_enclosure.humidityVar());
-    html::writeRowInto(out, s_shtc3_room.temperatureVar());
-    html::writeRowInto(out, s_shtc3_room.humidityVar());
-    html::writeTableEnd(out);
+  const ControlTiming& timing() const { return m_timing; }
+  const RelayAutotune& autotune() const { return m_autotune; }
+  const ThermalModel& thermalModel() const { return m_thermal_model; }
+
+  // Current control values, as recorded in the history and trace log.
+  HistoryInput historyInput() const {
+    return {
+        .enclosure_temp = s_shtc3_enclosure.temperature(),
+        .room_temp = s_shtc3_room.temperature(),
+        .target = s_pid.target().value(),
+        .enclosure_humidity = s_shtc3_enclosure.humidity(),
+        .room_humidity = s_shtc3_room.humidity(),
+        .p = s_pid.p_term(),
+        .i = s_pid.i_term(),
+        .d = s_pid.d_term(),
+        .ff = s_pid.ff_term(),
+        .heater = s_pwm_heater.dutyF(),
+        .state = static_cast<uint8_t>(m_state.value()),
+    };
+  }
+
+  void logTiming() {
+    char line[96];
+    for (unsigned idx = 0; idx < ControlTiming::kNumStages; idx++) {
+      m_timing.format(static_cast<ControlTiming::Stage>(idx), line, sizeof(line));
+      s_app.log().log(line);
+    }
+    m_timing.formatInterval(line, sizeof(line));
+    s_app.log().log(line);
+  }
+
+  // Streamed a row at a time, so the scratch String holds one row.
+  void writeHtmlStatusTable(HtmlChunkWriter* out) {
+    out->writeWith([](String* html) { html::writeTableStart(html, "Status"); });
+    const VariableBase* rows[] = {
+        &s_pid.target(),
+        &m_heat_mode,
+        &m_fan_mode,
+        &s_relay_fan.isHighVar(),
+        &s_shtc3_enclosure.temperatureVar(),
+        &s_shtc3_enclosure.humidityVar(),
+        &s_shtc3_room.temperatureVar(),
+        &s_shtc3_room.humidityVar(),
+    };
+    for (const VariableBase* row : rows) {
+      out->writeWith([row](String* html) { html::writeRowInto(html, *row); });
+    }
+    out->writeWith([](String* html) { html::writeTableEnd(html); });
   }
 
   void toJson(JsonObject& json) {
     json["state"] = state_names[m_state.value()];
     json["state_idx"] = static_cast<int>(m_state.value());
-    json["tempEnclosure"] = s_shtc3_enclosure.temperature();
-    json["humEnclosure"] = s_shtc3_enclosure.humidity();
-    json["tempRoom"] = s_shtc3_room.temperature();
-    json["humRoom"] = s_shtc3_room.humidity();
     json["tempFilt"] = s_temp_filter.value();
     json["tempDFilt"] = s_d_temp_filter.value();
     json["target"] = s_pid.target().value();
@@ -511,19 +1388,185 @@ class TempControl : public Module {
     json["cmdI"] = s_pid.i_term();
     json["cmdD"] = s_pid.d_term();
     json["cmdFF"] = s_pid.ff_term();
+    json["autotuneCycles"] = m_autotune.cyclesDone();
+    json["autotuneKu"] = m_autotune_ku.value();
+    json["autotuneTu"] = m_autotune_tu.value();
+    json["autotuneP"] = m_autotune_p.value();
+    json["autotuneI"] = m_autotune_i.value();
+    json["autotuneD"] = m_autotune_d.value();
+    json["ffModelPerDeltaC"] = m_ff_model_per_delta_c.value();
+    json["ffModelPerDeltaCSd"] = m_ff_model_per_delta_c_sd.value();
+    json["ffModelPerDeltaCOk"] = m_thermal_model.ffPerDeltaCOk();
+    json["ffModelPerRate"] = m_ff_model_per_rate.value();
+    json["ffModelPerRateSd"] = m_ff_model_per_rate_sd.value();
+    json["ffModelPerRateOk"] = m_thermal_model.ffPerRateOk();
+    json["ffReferenceTemp"] = m_ff_reference.value();
+    json["ffReferenceSource"] = m_ff_reference.sourceName();
+    json["roomSensorOk"] = m_room_ok;
+    json["roomSensorFailures"] = m_room_failures.value();
+    json["programName"] = m_program.name();
+    json["programRunning"] = m_program.running();
+    json["programSegment"] = m_program_segment.value();
+    json["programSegments"] = m_program.numSegments();
+    json["programSetTemp"] = m_program_set_temp.value();
+    json["programRemainingMin"] = m_program_remaining_min.value();
   }
 
  protected:
+  // Advance the fermentation program, if one is running, and return the temperature to
+  //  control to.
+  float updateProgram(unsigned long now_msec) {
+    if (!m_program.running()) {
+      return m_set_temp.value();
+    }
+    const float setpoint = m_program.setpoint(now_msec);
+    const uint32_t elapsed_sec = m_program.elapsedSec(now_msec);
+    m_program_set_temp = setpoint;
+    m_program_remaining_min =
+        elapsed_sec < m_program.totalSec() ? (m_program.totalSec() - elapsed_sec) / 60.0f : 0.0f;
+    if (m_program.finished(now_msec)) {
+      // Keep controlling to the final temperature.
+      s_app.log().logf("Program '%s' finished at %.1fC.", m_program.name(), setpoint);
+      m_set_temp = setpoint;
+      saveConfig(s_cmdvg);
+      s_mqtt_publisher.markDirty(s_cmdvg);
+      stopProgram();
+      return setpoint;
+    }
+    if (m_program.segmentIndex() != m_program_segment.value()) {
+      m_program_segment = m_program.segmentIndex();
+      s_app.log().logf("Program segment %u of %u.", m_program_segment.value() + 1,
+                       m_program.numSegments());
+      saveProgramRun(now_msec);
+    } else if (elapsed_sec - m_program_saved_sec >= kProgramSaveSec) {
+      saveProgramRun(now_msec);
+    }
+    return setpoint;
+  }
+
+  void saveProgramRun(unsigned long now_msec) {
+    m_program_saved_sec = m_program.elapsedSec(now_msec);
+    if (!writeProgramRun(m_program.runState(now_msec, epochSec()))) {
+      s_app.log().log("Failed to save program progress.");
+    }
+  }
+
+  void stopProgram() {
+    m_program.stop();
+    m_program_running = false;
+    m_program_remaining_min = 0.0f;
+    removeProgramRun();
+  }
+
+  // The temperature the static feedforward is relative to: the filtered room temperature
+  //  (and ffTrackRoom is set), the last one if the room sensor has stopped working, otherwise
+  //  the enclosure temperature when control was enabled.  See FeedforwardReference.
+  float ffReference(unsigned long now_msec) {
+    const float initial_temp = m_initial_temp != kUninitializedTemp ? m_initial_temp
+                                                                    : std::nanf("");
+    const bool track_room = m_room_ok && m_ff_track_room.value();
+    m_ff_reference_temp =
+        m_ff_reference.update(now_msec, track_room, s_room_filter.value(), initial_temp);
+    return m_ff_reference_temp.value();
+  }
+
+  // Record the autotune result, apply the gains if autotuneApply is set, and resume
+  //  normal control.
+  void finishAutotune() {
+    if (m_autotune.status() != RelayAutotune::Status::kDone) {
+      s_app.log().log("Autotune failed: no usable oscillation.");
+      setState(kStateCooldown, kUpdateOffMsec);
+      return;
+    }
+    const RelayAutotune::Result& result = m_autotune.result();
+    m_autotune_ku = result.ku;
+    m_autotune_tu = result.tu_sec;
+    m_autotune_p = result.kp;
+    m_autotune_i = result.ki;
+    m_autotune_d = result.kd;
+    s_app.log().logf("Autotune: Ku=%.3f Tu=%.0fs a=%.2fC -> kP=%.4f kI=%.6f kD=%.2f", result.ku,
+                     result.tu_sec, result.amplitude, result.kp, result.ki, result.kd);
+    if (m_autotune_apply.value()) {
+      applyGains(result);
+    }
+    s_mqtt_publisher.markDirty(s_vg);
+    setEnable();
+  }
+
+  // Set the PID gains through the config variables the PID registered in s_cvg.  If one of
+  //  them is not there, nothing is changed and the error is logged.
+  bool applyGains(const RelayAutotune::Result& result) {
+    static const char* const kGainNames[] = {"kP", "kI", "kD"};
+    JsonDocument cfgdoc;
+    JsonObject cfg = cfgdoc.to<JsonObject>();
+    s_cvg.toJson(cfg, VariableBase::kConfig);
+    for (const char* name : kGainNames) {
+      if (cfg[name].isNull()) {
+        s_app.log().logf("Autotune: no PID gain '%s' in %s: gains not applied.", name,
+                         s_cvg.name());
+        return false;
+      }
+    }
+    JsonDocument jsondoc;
+    jsondoc["kP"] = result.kp;
+    jsondoc["kI"] = result.ki;
+    jsondoc["kD"] = result.kd;
+    s_cvg.updateFromJson(jsondoc.as<JsonObject>());
+    saveConfig(s_cvg);
+    s_mqtt_publisher.markDirty(s_cvg);
+    s_app.log().log("Autotune: gains applied.");
+    return true;
+  }
+
+  // Values which cause their VariableGroup to be re-sent over MQTT when they change.
+  void addMqttWatches() {
+    auto& pub = s_mqtt_publisher;
+    pub.addGroup(s_vg);
+    // Send config variables unless marked kNoPublish.
+    pub.addGroup(s_cvg, VariableBase::kNoPublish | VariableBase::kConfig);
+    pub.addGroup(s_cmdvg, VariableBase::kConfig);
+
+    pub.watch(s_vg, []() { return s_shtc3_enclosure.temperature(); }, m_mqtt_temp_deadband);
+    pub.watch(s_vg, []() { return s_shtc3_room.temperature(); }, m_mqtt_temp_deadband);
+    pub.watch(s_vg, []() { return s_temp_filter.value(); }, m_mqtt_temp_deadband);
+    pub.watch(s_vg, []() { return s_pid.target().value(); }, m_mqtt_temp_deadband);
+    pub.watch(s_vg, []() { return s_shtc3_enclosure.humidity(); }, m_mqtt_humidity_deadband);
+    pub.watch(s_vg, []() { return s_shtc3_room.humidity(); }, m_mqtt_humidity_deadband);
+    pub.watch(s_vg, []() { return s_pwm_heater.dutyF(); }, m_mqtt_duty_deadband);
+    pub.watch(s_vg, [this]() { return static_cast<float>(m_state.value()); });
+    pub.watch(s_vg, []() { return s_relay_fan.isHigh() ? 1.0f : 0.0f; });
+    pub.watch(s_vg, [this]() { return m_fan_mode.value() == kOff ? 0.0f : 1.0f; });
+
+    pub.watch(s_vg, [this]() { return m_program_running.value() ? 1.0f : 0.0f; });
+    pub.watch(s_vg, [this]() { return static_cast<float>(m_program_segment.value()); });
+    pub.watch(s_vg, [this]() { return m_program_set_temp.value(); }, m_mqtt_temp_deadband);
+    pub.watch(s_vg, [this]() { return std::floor(m_program_remaining_min.value()); });
+
+    pub.watch(s_cmdvg, [this]() { return m_set_temp.value(); });
+    pub.watch(s_cmdvg, [this]() { return m_test_command.value(); });
+    pub.watch(s_cmdvg, [this]() { return m_test_command_time.value(); });
+  }
+
   void setState(State state, unsigned msec) {
     if (m_state.value() != state) {
       s_app.log().logf("state %u -> %u.", static_cast<unsigned>(m_state.value()),
                        static_cast<unsigned>(state));
+      const State from_state = m_state.value();
       m_state = state;
       m_last_state_change_msec = millis();
       s_pid.initialize();
       m_heat_mode = enabled() ? kHeat : kOff;
+      s_trace.addTransition(m_last_state_change_msec, from_state, historyInput());
+      if (state == kStateError) {
+        s_trace.flush();  // Get the lead-up to the error onto flash promptly.
+      }
+    }
+    // Update once msec has passed, at the next tick at the soonest.  Stop heating now if the
+    //  new state does not heat.
+    sameState(msec);
+    if (state != kStateEnabled && state != kStateCommand && state != kStateAutotune) {
+      heaterOff();
     }
-    m_scheduler.runIn(1, [this]() { update(); });
     // Internal LED follows enable/disable state.
     if (enabled()) {
       s_blink.on();
@@ -532,54 +1575,30 @@ class TempControl : public Module {
     }
   }
   void sameState(unsigned msec) {
-    m_scheduler.runIn(msec, [this]() { update(); });
+    m_ticks_to_update = std::max(1u, (msec + kUpdateOnMsec - 1) / kUpdateOnMsec);
   }
 
-  void mqttSetMode(const char* topic, const char* payload, size_t len) {
-    if (0 == strncmp(payload, kOff, len)) {
-      delaySetEnable(false);
-    } else if (0 == strncmp(payload, kHeat, len)) {
-      delaySetEnable(true);
-    } else {
-      s_app.log().logf("setMode('%s', (%d)'%s') unknown mode", topic, static_cast<int>(len),
-                       payload);
-    }
-  }
-  void mqttSetFanMode(const char* topic, const char* payload, size_t len) {
-    if (0 == strncmp(payload, kOff, len)) {
-      m_fan_mode = kOff;
-      turnFanOff();
-    } else if (0 == strncmp(payload, kHigh, len)) {
-      m_fan_mode = kHigh;
-      turnFanOn();
-    } else {
-      s_app.log().logf("setMode('%s', (%d)'%s') unknown mode", topic, static_cast<int>(len),
-                       payload);
-    }
-  }
-  void mqttSetTargetTemp(const char* topic, const char* payload, size_t len) {
-    float temp = 0.0f;
-    if (1 != sscanf(payload, "%f", &temp)) {
-      s_app.log().logf("setTargetTemp('%s', (%d)'%s') failed to parse payload temp", topic,
-                       static_cast<int>(len), payload);
-    } else if (temp > kTargetTempMax) {
-      s_app.log().logf("setTargetTemp('%s', %g) target too high", topic, temp);
-    } else if (temp < kTargetTempMin) {
-      s_app.log().logf("setTargetTemp('%s', %g) target too low", topic, temp);
-    } else {
-      setTargetTemp(temp);
+  // The thermostat's discovery entry, built once (and again if the device id changes) and
+  //  kept as MessagePack.
+  const std::vector<uint8_t>& climateDiscovery(HADiscovery* had) {
+    if (m_climate_discovery.empty() || m_climate_device_id != had->deviceId()) {
+      JsonDocument json;
+      buildClimateDiscovery(had, &json);
+      m_climate_discovery.resize(measureMsgPack(json));
+      serializeMsgPack(json, m_climate_discovery.data(), m_climate_discovery.size());
+      m_climate_device_id = had->deviceId();
     }
+    return m_climate_discovery;
   }
-  bool haDiscovery(HADiscovery* had, JsonDocument* json) {
-    json->clear();
 
+  void buildClimateDiscovery(HADiscovery* had, JsonDocument* json) {
     {
       // The variable is not used for addRoot() -- this just sets device informaton.
       HADiscovery::Entry entry(m_temp_min_ok, ha::device_type::kClimate, nullptr);
       had->addRoot(json, entry);
     }
 
-    String name = "thermostat";
+    const char* name = kHaThermostatName;
     auto& js = *json;
     js["name"] = name;
     js["mode_cmd_t"] = "~/mode/set";
@@ -603,20 +1622,47 @@ class TempControl : public Module {
     js["fan_modes"][1] = kHigh;
 
     char value[128];
-    snprintf(value, sizeof(value), "%s_%s", had->deviceId(), name.c_str());
+    snprintf(value, sizeof(value), "%s_%s", had->deviceId(), name);
     js["uniq_id"] = value;
+  }
 
-    had->mqttSubscribe("mode/set", [this](const char* topic, const char* payload, size_t len) {
-      this->mqttSetMode(topic, payload, len);
-    });
-    had->mqttSubscribe("fan_mode/set", [this](const char* topic, const char* payload, size_t len) {
-      this->mqttSetFanMode(topic, payload, len);
-    });
-    had->mqttSubscribe("set_temp/set", [this](const char* topic, const char* payload, size_t len) {
-      this->mqttSetTargetTemp(topic, payload, len);
+  // The command topics and HA's status topic are subscribed to once: the subscriptions are
+  //  kept across reconnects.
+  void mqttSubscribe(HADiscovery* had) {
+    if (m_mqtt_subscribed) {
+      return;
+    }
+    m_mqtt_subscribed = true;
+    s_app.mqtt_manager().subscribe(kHaStatusTopic,
+                                   [had](const char* topic, const char* payload, size_t len) {
+                                     s_ha_announcer.onStatus(had, payload, len);
+                                   });
+    for (const MqttCommandRoute& route : kMqttCommandRoutes) {
+      had->mqttSubscribe(route.topic,
+                         [&route](const char* topic, const char* payload, size_t len) {
+                           logCommandError(topic, payload, len,
+                                           s_mqtt_commands.onMessage(route, payload, len));
+                         });
+    }
+    had->mqttSubscribe(kMqttBatchTopic, [](const char* topic, const char* payload, size_t len) {
+      logCommandError(topic, payload, len, s_mqtt_commands.onBatch(payload, len));
     });
+  }
+  static void logCommandError(const char* topic, const char* payload, size_t len,
+                              const char* error) {
+    if (error) {
+      s_app.log().logf("MQTT %s '%.*s': %s", topic, static_cast<int>(len), payload, error);
+    }
+  }
 
-    return had->mqttSendConfig(name.c_str(), ha::device_type::kClimate, json);
+  bool haDiscovery(HADiscovery* had, JsonDocument* json) {
+    mqttSubscribe(had);
+    const std::vector<uint8_t>& entry = climateDiscovery(had);
+    json->clear();
+    if (deserializeMsgPack(*json, entry.data(), entry.size())) {
+      return false;
+    }
+    return had->mqttSendConfig(kHaThermostatName, ha::device_type::kClimate, json);
   }
 
  private:
@@ -626,6 +1672,17 @@ class TempControl : public Module {
   float m_last_temp = 0.0f;
   unsigned long m_last_msec = 0;
   unsigned long m_last_state_change_msec = 0;
+  unsigned long m_last_update_msec = 0;
+  uint32_t m_ticks_to_update = 1;
+  State m_last_update_state = kStateDisabled;
+  bool m_room_ok = false;
+  bool m_room_logged = false;  // m_room_ok has been logged
+  unsigned m_oled_screen = 0;  // index of show_state() in s_oled
+  std::vector<uint8_t> m_climate_discovery;  // see climateDiscovery()
+  String m_climate_device_id;
+  bool m_mqtt_subscribed = false;
+  unsigned long m_last_trace_msec = 0;
+  ControlTiming m_timing;
 
   FloatVariable m_temp_min_ok;
   FloatVariable m_temp_max_ok;
@@ -637,14 +1694,163 @@ class TempControl : public Module {
   FloatVariable m_test_command_time;
   Variable<String> m_heat_mode;  // heater mode for HA thermostat ('off' / 'on').
   Variable<String> m_fan_mode;   // fan mode for HA thermostat ('off' / 'high').
+  FloatVariable m_mqtt_temp_deadband;
+  FloatVariable m_mqtt_humidity_deadband;
+  FloatVariable m_mqtt_duty_deadband;
+  FloatVariable m_mqtt_keepalive_sec;
+  FloatVariable m_trace_tick_sec;
+  FloatVariable m_autotune_output;
+  FloatVariable m_autotune_hysteresis;
+  BoolVariable m_autotune_apply;
+  FloatVariable m_autotune_ku;
+  FloatVariable m_autotune_tu;
+  FloatVariable m_autotune_p;
+  FloatVariable m_autotune_i;
+  FloatVariable m_autotune_d;
+  RelayAutotune m_autotune;
+  BoolVariable m_ff_adaptive;
+  FloatVariable m_ff_model_forgetting;
+  FloatVariable m_ff_model_per_delta_c;
+  FloatVariable m_ff_model_per_delta_c_sd;
+  FloatVariable m_ff_model_per_rate;
+  FloatVariable m_ff_model_per_rate_sd;
+  BoolVariable m_program_running;
+  Variable<unsigned> m_program_segment;
+  FloatVariable m_program_set_temp;
+  FloatVariable m_program_remaining_min;
+  BoolVariable m_ff_track_room;
+  FloatVariable m_ff_reference_temp;
+  Variable<unsigned> m_room_failures;
+  FeedforwardReference m_ff_reference;
+  ThermalModel m_thermal_model;
+  FermentProgram m_program;
+  uint32_t m_program_saved_sec = 0;  // elapsed time at the last saveProgramRun()
+  // When a run resumes after a restart: the wall-clock time and elapsed time it was saved
+  //  at, for counting the time the device was off.  Zero once accounted for.
+  uint32_t m_resume_epoch_sec = 0;
+  uint32_t m_resume_elapsed_sec = 0;
 };
 
 const char* TempControl::state_names[] = {
-    "Off", "Running", "Cooling...", "Error!", "Test Command",
+    "Off", "Running", "Cooling...", "Error!", "Test Command", "Autotune",
 };
 
 TempControl s_temp_control;
 
+// Summaries of the performance counters, sent over MQTT when perfMqtt is set.
+VariableGroup s_perf_vg("dough_perf");
+BoolVariable s_perf_mqtt("perfMqtt", false, "Publish performance counters",
+                         VariableBase::kSettable | VariableBase::kConfig, s_cvg);
+Variable<unsigned> s_perf_loop_p99("loopP99Usec", 0, "usec", "Main loop p99", 0, s_perf_vg);
+Variable<unsigned> s_perf_loop_max("loopMaxUsec", 0, "usec", "Main loop max", 0, s_perf_vg);
+Variable<unsigned> s_perf_update_p99("updateP99Usec", 0, "usec", "Control update p99", 0,
+                                     s_perf_vg);
+Variable<unsigned> s_perf_http_max("httpMaxUsec", 0, "usec", "Slowest HTTP request", 0,
+                                   s_perf_vg);
+Variable<unsigned> s_perf_mqtt_sends("mqttSends", 0, "", "MQTT group sends", 0, s_perf_vg);
+Variable<unsigned> s_perf_mqtt_bytes("mqttBytes", 0, "bytes", "MQTT bytes sent", 0, s_perf_vg);
+Variable<unsigned> s_perf_free_heap("freeHeap", 0, "bytes", "Free heap", 0, s_perf_vg);
+Variable<unsigned> s_perf_min_free_heap("minFreeHeap", 0, "bytes", "Minimum free heap", 0,
+                                        s_perf_vg);
+Variable<unsigned> s_perf_largest_block("largestFreeBlock", 0, "bytes", "Largest free block",
+                                        0, s_perf_vg);
+Variable<unsigned> s_perf_loop_stack("loopStackFree", 0, "bytes", "Main loop stack headroom",
+                                     0, s_perf_vg);
+#ifndef NATIVE
+TaskHandle_t s_loop_task = nullptr;  // set in setup()
+#endif
+
+// Boot timing, from reset (as measured by micros()) to each step.
+FloatVariable s_boot_setup_msec("bootSetupMsec", 0.0f, "msec", "Reset to setup()",
+                                VariableBase::kNoPublish, 1, s_vg);
+FloatVariable s_boot_config_msec("bootConfigMsec", 0.0f, "msec", "Config load time",
+                                 VariableBase::kNoPublish, 1, s_vg);
+FloatVariable s_boot_update_msec("bootUpdateMsec", 0.0f, "msec", "Reset to first update",
+                                 VariableBase::kNoPublish, 1, s_vg);
+FloatVariable s_boot_tick_msec("bootTickMsec", 0.0f, "msec", "Reset to first control tick",
+                               VariableBase::kNoPublish, 1, s_vg);
+BoolVariable s_boot_config_snapshot("bootConfigSnapshot", false, "Config loaded from snapshot",
+                                    VariableBase::kNoPublish, s_vg);
+
+void publishPerf() {
+  s_perf_loop_p99 = s_perf.loopUsec().percentile(0.99f);
+  s_perf_loop_max = s_perf.loopUsec().max();
+  s_perf_update_p99 = s_temp_control.timing().stage(ControlTiming::kTotal).percentile(0.99f);
+  uint32_t http_max = 0;
+  for (unsigned idx = 0; idx < s_perf.numRoutes(); idx++) {
+    http_max = std::max(http_max, s_perf.route(idx).usec.max());
+  }
+  s_perf_http_max = http_max;
+  s_perf_mqtt_sends = s_perf.mqttSends();
+  s_perf_mqtt_bytes = s_perf.mqttBytes();
+#ifndef NATIVE
+  s_perf_free_heap = ESP.getFreeHeap();
+  s_perf_min_free_heap = ESP.getMinFreeHeap();
+  s_perf_largest_block = ESP.getMaxAllocHeap();
+  s_perf_loop_stack = uxTaskGetStackHighWaterMark(s_loop_task);
+#endif
+  if (s_perf_mqtt.value()) {
+    s_app.mqttSend(s_perf_vg);
+  }
+}
+
+// The fixed-rate control tick, and statistics on how late ticks start.
+Variable<unsigned> s_tick_overruns("tickOverruns", 0, "", "Control ticks missed",
+                                   VariableBase::kNoPublish, s_vg);
+FloatVariable s_tick_late_p50("tickLateP50", 0.0f, "msec", "Control tick lateness p50",
+                              VariableBase::kNoPublish, 1, s_vg);
+FloatVariable s_tick_late_p99("tickLateP99", 0.0f, "msec", "Control tick lateness p99",
+                              VariableBase::kNoPublish, 1, s_vg);
+FloatVariable s_tick_late_max("tickLateMax", 0.0f, "msec", "Control tick lateness max",
+                              VariableBase::kNoPublish, 1, s_vg);
+
+void controlTick(unsigned long deadline_msec, uint32_t periods);
+ControlTicker s_ticker(kUpdateOnMsec, controlTick);
+uint32_t s_control_ticks = 0;
+
+// The control tick: also run for each tick of a replayed trace.
+void controlTick(unsigned long deadline_msec, uint32_t periods) {
+  s_control_ticks += 1;
+  // Take the newest sensor sample on every tick, whether or not the control update runs.
+  s_sensors.refresh();
+  s_temp_control.checkProgramClock();
+  // Commands are traced as they are applied, before this tick's input.
+  MqttCommand command;
+  while (s_mqtt_commands.poll(&command)) {
+    s_temp_control.applyCommand(command);
+  }
+  s_ha_announcer.poll();
+  traceInput(deadline_msec, periods);
+  s_temp_control.onTick(deadline_msec, periods);
+  if (s_control_ticks == 1) {
+    s_boot_tick_msec = micros() * 1e-3f;
+    s_app.log().logf("Boot: setup %.0f ms, config %.1f ms (%s), first update %.0f ms, first "
+                     "tick %.0f ms.",
+                     s_boot_setup_msec.value(), s_boot_config_msec.value(),
+                     s_boot_config_snapshot.value() ? "snapshot" : "json",
+                     s_boot_update_msec.value(), s_boot_tick_msec.value());
+  }
+  s_config_persister.poll(millis());
+  if (s_control_ticks % kPerfPublishTicks == 0) {
+    publishPerf();
+  }
+  s_tick_overruns = s_ticker.numOverruns();
+  const LatencyHistogram& lateness = s_ticker.lateness();
+  if (lateness.count() >= kTickStatsTicks) {
+    s_tick_late_p50 = lateness.percentile(0.5f) * 1e-3f;
+    s_tick_late_p99 = lateness.percentile(0.99f) * 1e-3f;
+    s_tick_late_max = lateness.max() * 1e-3f;
+    s_ticker.clearLateness();
+  }
+}
+
+// The update in setup(), which starts the system reporting state: temperature, etc.
+void firstUpdate(unsigned long now_msec) {
+  s_sensors.refresh();
+  traceInput(now_msec, 0);
+  s_temp_control.update(now_msec);
+}
+
 #define CONFIG_URL "/configure"
 const char* s_config_url = CONFIG_URL;
 
@@ -668,6 +1874,13 @@ og3::NetHandlerStatus handleTestCommand(og3::NetRequest* request, og3::NetRespon
   NET_REPLY(request, ESP_OK);
 }
 
+og3::NetHandlerStatus handleAutotune(og3::NetRequest* request, og3::NetResponse* response) {
+  s_app.log().logf("http -> autotune");
+  s_temp_control.delayStartAutotune();
+  response->redirect("/");
+  NET_REPLY(request, ESP_OK);
+}
+
 og3::NetHandlerStatus handleFanRelay(og3::NetRequest* request, og3::NetResponse* response) {
   s_blink.blink(2);
   s_app.log().logf("turning on fan for %u msec.", kFanOnMsec);
@@ -687,33 +1900,51 @@ og3::NetHandlerStatus handleHeaterRelay(og3::NetRequest* request, og3::NetRespon
   NET_REPLY(request, ESP_OK);
 }
 
-// The send of the web page happens asynchronously, so we need to make
-//  sure the storage for the page remains after they are rendered to html.
-// That is why html is stored in this static variable.
-static String s_html;
+// The page around the /old tables, streamed by sendOldPage().
+constexpr char kOldPageTemplate[] =
+    "<!DOCTYPE html><html><head><meta charset=\"utf-8\">"
+    "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">"
+    "<title>{{title}}</title></head><body><h2>{{title}}</h2>{{body}}"
+    "<p><small>{{software}}</small></p></body></html>";
+
+// Stream an /old page, with write_body(HtmlChunkWriter*) writing the tables and buttons.
+template <typename BodyFn>
+NetHandlerStatus sendOldPage(NetRequest* request, NetResponse* response, BodyFn&& write_body) {
+  HtmlChunkWriter out(request, response);
+  out.writeTemplate(kOldPageTemplate, [&out, &write_body](const char* name, size_t len) {
+    if (0 == strncmp(name, "title", len)) {
+      out.write(s_app.board_cname());
+    } else if (0 == strncmp(name, "software", len)) {
+      out.write(kSoftware);
+    } else if (0 == strncmp(name, "body", len)) {
+      write_body(&out);
+    }
+  });
+  return out.end();
+}
 
 og3::NetHandlerStatus handleUpdateTarget(og3::NetRequest* request, og3::NetResponse* response) {
 #ifndef NATIVE
-  s_html.clear();
   ::og3::read(*request, s_cmdvg);
-  html::writeFormTableInto(&s_html, s_cmdvg);
-  s_html += HTML_BUTTON("/", "Back");
-  sendWrappedHTML(request, response, s_app.board_cname(), kSoftware, s_html.c_str());
-  s_app.config().write_config(s_cmdvg);
+  saveConfig(s_cmdvg);
+  s_mqtt_publisher.markDirty(s_cmdvg);
 #endif
-  NET_REPLY(request, ESP_OK);
+  return sendOldPage(request, response, [](HtmlChunkWriter* out) {
+    out->writeWith([](String* html) { html::writeFormTableInto(html, s_cmdvg); });
+    out->write(HTML_BUTTON("/", "Back"));
+  });
 }
 
 og3::NetHandlerStatus handleUpdateConfig(og3::NetRequest* request, og3::NetResponse* response) {
 #ifndef NATIVE
-  s_html.clear();
   ::og3::read(*request, s_cvg);
-  html::writeFormTableInto(&s_html, s_cvg);
-  s_html += HTML_BUTTON(CONFIG_URL, "Back");
-  sendWrappedHTML(request, response, s_app.board_cname(), kSoftware, s_html.c_str());
-  s_app.config().write_config(s_cvg);
+  saveConfig(s_cvg);
+  s_mqtt_publisher.markDirty(s_cvg);
 #endif
-  NET_REPLY(request, ESP_OK);
+  return sendOldPage(request, response, [](HtmlChunkWriter* out) {
+    out->writeWith([](String* html) { html::writeFormTableInto(html, s_cvg); });
+    out->write(HTML_BUTTON(CONFIG_URL, "Back"));
+  });
 }
 
 og3::WebButton s_button_wifi_config = s_app.createWifiConfigButton();
@@ -731,6 +1962,8 @@ og3::WebButton s_button_disable(&s_app.web_server_module().native_server(), "Tur
                                 "/doughlee/disable", handleDisable);
 og3::WebButton s_button_test_command(&s_app.web_server_module().native_server(), "Test command",
                                      "/doughlee/test_command", handleTestCommand);
+og3::WebButton s_button_autotune(&s_app.web_server_module().native_server(), "Autotune",
+                                 "/doughlee/autotune", handleAutotune);
 og3::WebButton s_button_doughl33_target(&s_app.web_server_module().native_server(),
                                         "Set target temp", "/doughlee/target", handleUpdateTarget);
 og3::WebButton s_button_doughl33_config(&s_app.web_server_module().native_server(),
@@ -742,56 +1975,77 @@ og3::WebButton s_button_test_heater(&s_app.web_server_module().native_server(),
                                     "/relay/heater", handleHeaterRelay);
 
 og3::NetHandlerStatus handleWebRoot(og3::NetRequest* request, og3::NetResponse* response) {
-  s_html.clear();
-  s_temp_control.writeHtmlStatusTable(&s_html);
-
-  og3::html::writeTableStart(&s_html, "Connection");
-  og3::html::writeRowInto(&s_html, s_app.wifi_manager().ipAddrVariable(), "IP address");
-  og3::html::writeRowInto(&s_html, s_app.mqtt_manager().connectionStatusVariable(),
-                          "MQTT connection");
-  og3::html::writeTableEnd(&s_html);
-
-  if (s_temp_control.enabled()) {
-    s_button_disable.add_button(&s_html);
-  } else {
-    s_button_enable.add_button(&s_html);
-  }
-  s_button_test_command.add_button(&s_html);
-  s_button_doughl33_target.add_button(&s_html);
-  s_button_config.add_button(&s_html);
-  s_button_restart.add_button(&s_html);
-  og3::sendWrappedHTML(request, response, s_app.board_cname(), kSoftware, s_html.c_str());
-  NET_REPLY(request, ESP_OK);
+  return sendOldPage(request, response, [](HtmlChunkWriter* out) {
+    s_temp_control.writeHtmlStatusTable(out);
+    out->writeWith([](String* html) {
+      og3::html::writeTableStart(html, "Connection");
+      og3::html::writeRowInto(html, s_app.wifi_manager().ipAddrVariable(), "IP address");
+      og3::html::writeRowInto(html, s_app.mqtt_manager().connectionStatusVariable(),
+                              "MQTT connection");
+      og3::html::writeTableEnd(html);
+    });
+    WebButton* buttons[] = {
+        s_temp_control.enabled() ? &s_button_disable : &s_button_enable,
+        &s_button_test_command,
+        &s_button_autotune,
+        &s_button_doughl33_target,
+        &s_button_config,
+        &s_button_restart,
+    };
+    for (WebButton* button : buttons) {
+      out->writeWith([button](String* html) { button->add_button(html); });
+    }
+  });
 }
 
 og3::NetHandlerStatus handleConfigure(og3::NetRequest* request, og3::NetResponse* response) {
-  s_html.clear();
-  og3::html::writeTableInto(&s_html, s_vg, "Control status");
-  og3::html::writeTableInto(&s_html, s_app.wifi_manager().variables());
-  og3::html::writeTableInto(&s_html, s_app.mqtt_manager().variables());
-
-  s_button_wifi_config.add_button(&s_html);
-  s_button_mqtt_config.add_button(&s_html);
-  s_button_app_status.add_button(&s_html);
-
-  s_button_doughl33_config.add_button(&s_html);
-  s_button_test_fan.add_button(&s_html);
-  s_button_test_heater.add_button(&s_html);
-  s_html += HTML_BUTTON("/", "Back");
-  og3::sendWrappedHTML(request, response, s_app.board_cname(), kSoftware, s_html.c_str());
-  NET_REPLY(request, ESP_OK);
+  return sendOldPage(request, response, [](HtmlChunkWriter* out) {
+    out->writeWith([](String* html) { og3::html::writeTableInto(html, s_vg, "Control status"); });
+    out->writeWith(
+        [](String* html) { og3::html::writeTableInto(html, s_app.wifi_manager().variables()); });
+    out->writeWith(
+        [](String* html) { og3::html::writeTableInto(html, s_app.mqtt_manager().variables()); });
+    WebButton* buttons[] = {
+        &s_button_wifi_config,     &s_button_mqtt_config, &s_button_app_status,
+        &s_button_doughl33_config, &s_button_test_fan,    &s_button_test_heater,
+    };
+    for (WebButton* button : buttons) {
+      out->writeWith([button](String* html) { button->add_button(html); });
+    }
+    out->write(HTML_BUTTON("/", "Back"));
+  });
 }
 
-static String s_body;
+// Sizes of the fixed buffers used to build and serialize /api JSON responses.
+constexpr size_t kJsonArenaSize = 3072;
+constexpr size_t kJsonOutSize = 2048;
+
+// Each /api GET request borrows one of these while its handler runs.  PsychicHttp sends the
+//  body before the handler returns, so the buffer is free again once send() is done.
+// There is no heap allocation per request, and concurrent requests do not share a buffer.
+JsonScratchPool<2, kJsonArenaSize, kJsonOutSize> s_json_pool;
+
+// Build a JSON object with fill_fn(JsonObject&) and send it as the response.
+template <typename FillFn>
+NetHandlerStatus sendJson(NetRequest* request, NetResponse* response, FillFn&& fill_fn) {
+  decltype(s_json_pool)::Lease lease(&s_json_pool);
+  if (!lease.ok()) {
+    response->send(503, "text/plain", "busy");
+    NET_REPLY(request, ESP_FAIL);
+  }
+  if (0 == lease.scratch().build(fill_fn)) {
+    s_app.log().logf("%s: JSON response too large", __func__);
+    response->send(500, "text/plain", "response too large");
+    NET_REPLY(request, ESP_FAIL);
+  }
+  response->send(200, "application/json", lease.scratch().out());
+  NET_REPLY(request, ESP_OK);
+}
 
 NetHandlerStatus apiGetWifi(NetRequest* request, NetResponse* response) {
-  JsonDocument jsondoc;
-  JsonObject json = jsondoc.to<JsonObject>();
-  s_app.wifi_manager().variables().toJson(json, VariableBase::kConfig);
-  s_body.clear();
-  serializeJson(jsondoc, s_body);
-  response->send(200, "application/json", s_body.c_str());
-  NET_REPLY(request, ESP_OK);
+  return sendJson(request, response, [](JsonObject& json) {
+    s_app.wifi_manager().variables().toJson(json, VariableBase::kConfig);
+  });
 }
 
 NetHandlerStatus putWifiConfig(NetRequest* request, NetResponse* response, JsonVariant& jsonIn) {
@@ -801,19 +2055,15 @@ NetHandlerStatus putWifiConfig(NetRequest* request, NetResponse* response, JsonV
   }
   JsonObject obj = jsonIn.as<JsonObject>();
   s_app.wifi_manager().variables().updateFromJson(obj);
-  s_app.config().write_config(s_app.wifi_manager().variables());
+  saveConfig(s_app.wifi_manager().variables());
   response->send(200, "text/plain", "ok");
   NET_REPLY(request, ESP_OK);
 }
 
 NetHandlerStatus apiGetMqtt(NetRequest* request, NetResponse* response) {
-  JsonDocument jsondoc;
-  JsonObject json = jsondoc.to<JsonObject>();
-  s_app.mqtt_manager().variables().toJson(json, VariableBase::kConfig);
-  s_body.clear();
-  serializeJson(jsondoc, s_body);
-  response->send(200, "application/json", s_body.c_str());
-  NET_REPLY(request, ESP_OK);
+  return sendJson(request, response, [](JsonObject& json) {
+    s_app.mqtt_manager().variables().toJson(json, VariableBase::kConfig);
+  });
 }
 
 NetHandlerStatus putMqttConfig(NetRequest* request, NetResponse* response, JsonVariant& jsonIn) {
@@ -823,7 +2073,7 @@ NetHandlerStatus putMqttConfig(NetRequest* request, NetResponse* response, JsonV
   }
   JsonObject obj = jsonIn.as<JsonObject>();
   s_app.mqtt_manager().variables().updateFromJson(obj);
-  s_app.config().write_config(s_app.mqtt_manager().variables());
+  saveConfig(s_app.mqtt_manager().variables());
   if (s_app.mqtt_manager().isEnabled() && !s_app.mqtt_manager().isConnected()) {
     s_app.mqtt_manager().connect();
   } else if (!s_app.mqtt_manager().isEnabled() && s_app.mqtt_manager().isConnected()) {
@@ -833,32 +2083,228 @@ NetHandlerStatus putMqttConfig(NetRequest* request, NetResponse* response, JsonV
   NET_REPLY(request, ESP_OK);
 }
 
-NetHandlerStatus apiGetStatus(NetRequest* request, NetResponse* response) {
-  JsonDocument jsondoc;
-  JsonObject json = jsondoc.to<JsonObject>();
+// Runs in the web server's task, so it reads the sample last published by the main loop.
+void statusToJson(JsonObject& json) {
+  const SensorSample sample = s_sensors.published();
   json["mqttConnected"] = s_app.mqtt_manager().isConnected();
   json["software"] = VERSION;
   json["hardware"] = "Dough133";
 
   s_temp_control.toJson(json);
-
-  s_body.clear();
-  serializeJson(jsondoc, s_body);
-  response->send(200, "application/json", s_body.c_str());
-  NET_REPLY(request, ESP_OK);
+  // The sensor values and their age all come from the same sample.
+  json["tempEnclosure"] = sample.enclosure_temp;
+  json["humEnclosure"] = sample.enclosure_humidity;
+  json["tempRoom"] = sample.room_temp;
+  json["humRoom"] = sample.room_humidity;
+  json["tickOverruns"] = s_tick_overruns.value();
+  json["tickLateP50"] = s_tick_late_p50.value();
+  json["tickLateP99"] = s_tick_late_p99.value();
+  json["tickLateMax"] = s_tick_late_max.value();
+  json["sensorAgeMsec"] = millis() - sample.msec;
+  json["sensorCacheHits"] = s_sensors.numHits();
+  json["sensorCacheReads"] = s_sensors.numReads();
+  json["sensorReadErrors"] = s_sensor_task.numReadErrors();
+  json["sensorDropped"] = s_sensor_task.numDropped();
 }
 
-NetHandlerStatus apiGetConfig(NetRequest* request, NetResponse* response) {
+// About the size of the JSON which s_app.mqttSend() sends for a group, for the MQTT byte count.
+// og3 builds and sends the JSON itself.  Rather than build it a second time on every send,
+//  each group is measured on its first send and that size is re-used: a group's keys stay the
+//  same and only the digits of its values change.
+size_t mqttPayloadBytes(const VariableGroup& vg, unsigned flags) {
+  struct GroupSize {
+    const VariableGroup* vg;
+    unsigned flags;
+    size_t bytes;
+  };
+  static std::vector<GroupSize> s_sizes;  // Only used by the main loop.
+  for (const GroupSize& size : s_sizes) {
+    if (size.vg == &vg && size.flags == flags) {
+      return size.bytes;
+    }
+  }
   JsonDocument jsondoc;
   JsonObject json = jsondoc.to<JsonObject>();
-  s_cvg.toJson(json, VariableBase::kConfig);
-  s_cmdvg.toJson(json, VariableBase::kConfig);
-  s_body.clear();
-  serializeJson(jsondoc, s_body);
-  response->send(200, "application/json", s_body.c_str());
+  vg.toJson(json, flags);
+  s_sizes.push_back({&vg, flags, measureJson(jsondoc)});
+  return s_sizes.back().bytes;
+}
+
+void histToJson(JsonObject json, const LatencyHistogram& hist) {
+  json["n"] = hist.count();
+  json["p50"] = hist.percentile(0.5f);
+  json["p99"] = hist.percentile(0.99f);
+  json["max"] = hist.max();
+}
+
+// Times are in microseconds.  Each row of "http" is [route, n, p50, p99, max].
+void perfToJson(JsonObject& json) {
+  json["uptimeSec"] = millis() / kMsecInSec;
+  JsonArray http = json["http"].to<JsonArray>();
+  for (unsigned idx = 0; idx < s_perf.numRoutes(); idx++) {
+    const PerfCounters::Route& route = s_perf.route(idx);
+    JsonArray row = http.add<JsonArray>();
+    row.add(route.name);
+    row.add(route.usec.count());
+    row.add(route.usec.percentile(0.5f));
+    row.add(route.usec.percentile(0.99f));
+    row.add(route.usec.max());
+  }
+  histToJson(json["loop"].to<JsonObject>(), s_perf.loopUsec());
+  histToJson(json["update"].to<JsonObject>(),
+             s_temp_control.timing().stage(ControlTiming::kTotal));
+  JsonObject boot = json["bootMsec"].to<JsonObject>();
+  boot["setup"] = s_boot_setup_msec.value();
+  boot["config"] = s_boot_config_msec.value();
+  boot["configSnapshot"] = s_boot_config_snapshot.value();
+  boot["firstUpdate"] = s_boot_update_msec.value();
+  boot["firstTick"] = s_boot_tick_msec.value();
+  json["mqttSends"] = s_perf.mqttSends();
+  json["mqttBytes"] = s_perf.mqttBytes();
+  json["mqttCommands"] = s_mqtt_commands.numQueued();
+  json["mqttCommandErrors"] = s_mqtt_commands.numErrors();
+  json["mqttCommandsDropped"] = s_mqtt_commands.numDropped();
+  json["haDiscoverySent"] = s_ha_announcer.numSent();
+  json["haDiscoverySkipped"] = s_ha_announcer.numSkipped();
+  JsonObject oled = json["oled"].to<JsonObject>();
+  oled["renders"] = s_oled.numRenders();
+  oled["skipped"] = s_oled.numSkipped();
+  oled["pagesSent"] = s_oled.numPagesSent();
+  oled["bytesSent"] = s_oled.numBytesSent();
+  oled["maxSendUsec"] = s_oled.maxSendUsec();
+#ifndef NATIVE
+  JsonObject heap = json["heap"].to<JsonObject>();
+  heap["free"] = ESP.getFreeHeap();
+  heap["minFree"] = ESP.getMinFreeHeap();
+  heap["largestBlock"] = ESP.getMaxAllocHeap();
+  // Least free stack seen so far, in bytes.  "http" is the web server task serving this.
+  JsonObject stack = json["stackFree"].to<JsonObject>();
+  stack["loop"] = uxTaskGetStackHighWaterMark(s_loop_task);
+  stack["http"] = uxTaskGetStackHighWaterMark(nullptr);
+  stack["trace"] = uxTaskGetStackHighWaterMark(s_trace.task());
+  stack["sensors"] = uxTaskGetStackHighWaterMark(s_sensor_task.task());
+  stack["display"] = uxTaskGetStackHighWaterMark(s_oled.task());
+#endif
+}
+
+// ?clear=1 restarts the histograms and counters after reporting them.
+NetHandlerStatus apiGetPerf(NetRequest* request, NetResponse* response) {
+  const NetHandlerStatus status =
+      sendJson(request, response, [](JsonObject& json) { perfToJson(json); });
+#ifndef NATIVE
+  if (request->hasParam("clear")) {
+    s_perf.clear();
+  }
+#endif
+  return status;
+}
+
+NetHandlerStatus apiGetStatus(NetRequest* request, NetResponse* response) {
+  return sendJson(request, response, [](JsonObject& json) { statusToJson(json); });
+}
+
+#ifndef NATIVE
+// Server-sent events stream of the same JSON as /api/status, sent once per control tick
+//  so that open browser tabs do not each need to poll.
+PsychicEventSource s_status_events;
+#endif
+
+void sendStatusEvent() {
+#ifndef NATIVE
+  if (s_status_events.count() == 0) {
+    return;
+  }
+  // The frame is serialized once and the same bytes are sent to every subscriber.
+  static JsonScratch<kJsonArenaSize, kJsonOutSize> s_frame;
+  if (s_frame.build([](JsonObject& json) { statusToJson(json); })) {
+    s_status_events.send(s_frame.out(), "status", millis());
+  }
+#endif
+}
+
+// /api/history?since=SEC returns the history samples recorded after SEC seconds since boot.
+// The body is a 12-byte header followed by packed HistorySamples, all little-endian:
+//   "DH", version (1), sample size (24), period sec (u16), reserved (u16), now sec (u32).
+// Samples are copied out of the ring a few at a time and sent as chunks, so the control loop
+//  is only held off for the copy of each chunk.
+NetHandlerStatus apiGetHistory(NetRequest* request, NetResponse* response) {
+#ifndef NATIVE
+  uint32_t since_sec = 0;
+  if (request->hasParam("since")) {
+    since_sec = strtoul(request->getParam("since")->value().c_str(), nullptr, 10);
+  }
+  uint8_t header[12] = {'D', 'H', 1, sizeof(HistorySample)};
+  const uint16_t period_sec = kHistoryPeriodSec;
+  const uint32_t now_sec = millis() / 1000;
+  memcpy(header + 4, &period_sec, sizeof(period_sec));
+  memcpy(header + 8, &now_sec, sizeof(now_sec));
+
+  response->setCode(200);
+  response->setContentType("application/octet-stream");
+  response->addHeader("Cache-Control", "no-store");
+  response->sendHeaders();
+  response->sendChunk(header, sizeof(header));
+  HistorySample samples[32];
+  decltype(s_history)::Cursor cursor;
+  while (const size_t num = s_history.copy(since_sec, &cursor, samples, 32)) {
+    if (ESP_OK !=
+        response->sendChunk(reinterpret_cast<uint8_t*>(samples), num * sizeof(HistorySample))) {
+      break;  // Client went away.
+    }
+  }
+  response->finishChunking();
+#endif
+  NET_REPLY(request, ESP_OK);
+}
+
+// /api/trace lists the trace log files and counters.
+// /api/trace?file=N returns the Nth newest trace file (see trace_log.h for the format).
+NetHandlerStatus apiGetTrace(NetRequest* request, NetResponse* response) {
+#ifndef NATIVE
+  char path[48];
+  if (!request->hasParam("file")) {
+    return sendJson(request, response, [&path](JsonObject& json) {
+      JsonArray files = json["files"].to<JsonArray>();
+      for (unsigned idx = 0; idx < s_trace.options().num_files; idx++) {
+        s_trace.filePath(idx, path, sizeof(path));
+        files.add(s_trace.fileSize(path));
+      }
+      json["writes"] = s_trace.numWrites();
+      json["bytesWritten"] = s_trace.bytesWritten();
+      json["writeErrors"] = s_trace.numWriteErrors();
+      json["dropped"] = s_trace.numDropped();
+    });
+  }
+  const unsigned idx = strtoul(request->getParam("file")->value().c_str(), nullptr, 10);
+  s_trace.filePath(idx, path, sizeof(path));
+  File file = idx < s_trace.options().num_files ? LittleFS.open(path, "r") : File();
+  if (!file) {
+    response->send(404, "text/plain", "no such trace file");
+    NET_REPLY(request, ESP_FAIL);
+  }
+  response->setCode(200);
+  response->setContentType("application/octet-stream");
+  response->addHeader("Cache-Control", "no-store");
+  response->sendHeaders();
+  uint8_t chunk[512];
+  while (const size_t num = file.read(chunk, sizeof(chunk))) {
+    if (ESP_OK != response->sendChunk(chunk, num)) {
+      break;  // Client went away.
+    }
+  }
+  file.close();
+  response->finishChunking();
+#endif
   NET_REPLY(request, ESP_OK);
 }
 
+NetHandlerStatus apiGetConfig(NetRequest* request, NetResponse* response) {
+  return sendJson(request, response, [](JsonObject& json) {
+    s_cvg.toJson(json, VariableBase::kConfig);
+    s_cmdvg.toJson(json, VariableBase::kConfig);
+  });
+}
+
 NetHandlerStatus putConfig(NetRequest* request, NetResponse* response, JsonVariant& jsonIn) {
   if (!jsonIn.is<JsonObject>()) {
     response->send(500, "text/plain", "not a json object");
@@ -866,9 +2312,11 @@ NetHandlerStatus putConfig(NetRequest* request, NetResponse* response, JsonVaria
   }
   JsonObject obj = jsonIn.as<JsonObject>();
   s_cvg.updateFromJson(obj);
-  s_app.config().write_config(s_cvg);
   s_cmdvg.updateFromJson(obj);
-  s_app.config().write_config(s_cmdvg);
+  saveConfig(s_cvg);
+  saveConfig(s_cmdvg);
+  s_mqtt_publisher.markDirty(s_cvg);
+  s_mqtt_publisher.markDirty(s_cmdvg);
   response->send(200, "text/plain", "ok");
   NET_REPLY(request, ESP_OK);
 }
@@ -887,12 +2335,14 @@ NetHandlerStatus apiPostDisable(NetRequest* request, NetResponse* response) {
 
 NetHandlerStatus apiPostFanOn(NetRequest* request, NetResponse* response) {
   s_temp_control.setFanOn();
+  s_app.tasks().runIn(1, []() { sendStatusEvent(); });
   response->send(200, "application/json", "{\"isOk\":true}");
   NET_REPLY(request, ESP_OK);
 }
 
 NetHandlerStatus apiPostFanOff(NetRequest* request, NetResponse* response) {
   s_temp_control.setFanOff();
+  s_app.tasks().runIn(1, []() { sendStatusEvent(); });
   response->send(200, "application/json", "{\"isOk\":true}");
   NET_REPLY(request, ESP_OK);
 }
@@ -904,7 +2354,8 @@ NetHandlerStatus apiPutTarget(NetRequest* request, NetResponse* response, JsonVa
   }
   JsonObject obj = jsonIn.as<JsonObject>();
   s_cmdvg.updateFromJson(obj);
-  s_app.config().write_config(s_cmdvg);
+  saveConfig(s_cmdvg);
+  s_app.tasks().runIn(1, []() { sendStatusEvent(); });
   response->send(200, "application/json", "{\"isOk\":true}");
   NET_REPLY(request, ESP_OK);
 }
@@ -915,67 +2366,444 @@ NetHandlerStatus apiPostTestCommand(NetRequest* request, NetResponse* response)
   NET_REPLY(request, ESP_OK);
 }
 
+NetHandlerStatus apiPostAutotune(NetRequest* request, NetResponse* response) {
+  s_temp_control.delayStartAutotune();
+  response->send(200, "application/json", "{\"isOk\":true}");
+  NET_REPLY(request, ESP_OK);
+}
+
+// GET /api/program returns the fermentation program and the progress of its run.
+NetHandlerStatus apiGetProgram(NetRequest* request, NetResponse* response) {
+  return sendJson(request, response, [](JsonObject& json) {
+    const FermentProgram& program = s_temp_control.program();
+    program.toJson(json);
+    json["running"] = program.running();
+    json["segment"] = program.segmentIndex();
+    json["totalMin"] = program.totalSec() / 60.0f;
+  });
+}
+
+// PUT /api/program replaces the program (stopping any run), e.g.
+//   {"name": "overnight", "segments": [{"type": "step", "temp": 26, "min": 180}, ...]}
+NetHandlerStatus apiPutProgram(NetRequest* request, NetResponse* response, JsonVariant& jsonIn) {
+  if (!jsonIn.is<JsonObject>()) {
+    response->send(500, "text/plain", "not a json object");
+    NET_REPLY(request, ESP_FAIL);
+  }
+  FermentProgram program;
+  const char* error = program.fromJson(jsonIn.as<JsonObject>(), kTargetTempMin, kTargetTempMax);
+  if (error) {
+    response->send(400, "text/plain", error);
+    NET_REPLY(request, ESP_FAIL);
+  }
+  // The program is swapped in by the main loop, which runs it.
+  s_app.tasks().runIn(1, [program]() { s_temp_control.setProgram(program); });
+  response->send(200, "application/json", "{\"isOk\":true}");
+  NET_REPLY(request, ESP_OK);
+}
+
+NetHandlerStatus apiPostProgramStart(NetRequest* request, NetResponse* response) {
+  s_temp_control.delayStartProgram();
+  response->send(200, "application/json", "{\"isOk\":true}");
+  NET_REPLY(request, ESP_OK);
+}
+
+NetHandlerStatus apiPostProgramStop(NetRequest* request, NetResponse* response) {
+  s_temp_control.delayStopProgram();
+  response->send(200, "application/json", "{\"isOk\":true}");
+  NET_REPLY(request, ESP_OK);
+}
+
+#ifdef NATIVE
+namespace sim {
+
+void setControlEnabled(bool enable) { s_temp_control.delaySetEnable(enable); }
+void setTargetTemp(float temp) { s_temp_control.setTargetTemp(temp); }
+void startAutotune() { s_temp_control.delayStartAutotune(); }
+
+const char* startProgram(const char* json) {
+  JsonDocument doc;
+  if (deserializeJson(doc, json, strlen(json))) {
+    return "not valid JSON";
+  }
+  FermentProgram program;
+  if (const char* error = program.fromJson(doc.as<JsonObject>(), kTargetTempMin, kTargetTempMax)) {
+    return error;
+  }
+  s_temp_control.setProgram(program);
+  s_temp_control.delayStartProgram();
+  return nullptr;
+}
+
+void beginReplay() { s_replaying = true; }
+
+void replayInput(unsigned long deadline_msec, uint32_t periods, const SensorSample& sample) {
+  s_replay_sample = sample;
+  s_replay_sample_ready = true;
+  if (periods == 0) {
+    firstUpdate(deadline_msec);
+  } else {
+    controlTick(deadline_msec, periods);
+  }
+}
+
+bool replayCommand(uint8_t id, const TraceCommand& command) {
+  // The enclosure reading the controller had when the command ran.
+  s_replay_sample = s_sensors.sample();
+  s_replay_sample.msec = command.sample_msec;
+  s_replay_sample.enclosure_temp = command.enclosure_temp;
+  s_replay_sample.enclosure_ok = command.enclosure_ok != 0;
+  s_replay_sample_ready = true;
+  s_sensors.refresh();
+  switch (id) {
+    case kTraceEnable:
+      if (command.value != 0.0f) {
+        s_temp_control.setEnable();
+      } else {
+        s_temp_control.setDisable();
+      }
+      return true;
+    case kTraceButton:
+      s_temp_control.onButton(static_cast<ButtonEvents::Event>(command.param));
+      return true;
+    case kTraceTestCommand:
+      s_temp_control.startTestCommand();
+      return true;
+    case kTraceAutotune:
+      s_temp_control.startAutotune();
+      return true;
+    case kTraceSetTemp:
+      s_temp_control.setTargetTemp(command.value);
+      return true;
+    case kTraceFanMode:
+      s_temp_control.setFanMode(command.param != 0);
+      return true;
+    case kTraceProgramStart:
+      s_temp_control.startProgram();
+      return true;
+    case kTraceProgramStop:
+      s_temp_control.cancelProgram();
+      return true;
+    case kTraceProgramResume:
+      s_temp_control.resumeProgram(command.value, command.param, 0);
+      return true;
+    case kTraceProgramSkip:
+      s_temp_control.skipProgram(command.param);
+      return true;
+  }
+  return false;
+}
+
+bool replayDocument(uint8_t kind, const char* text, size_t len) {
+  JsonDocument doc;
+  if (deserializeJson(doc, text, len)) {
+    return false;
+  }
+  if (kind == kTraceConfig) {
+    for (VariableGroup* vg : {&s_cvg, &s_cmdvg}) {
+      vg->updateFromJson(doc[vg->name()].as<JsonObject>());
+    }
+    return true;
+  }
+  FermentProgram program;
+  if (kind != kTraceProgram ||
+      program.fromJson(doc.as<JsonObject>(), kTargetTempMin, kTargetTempMax)) {
+    return false;
+  }
+  s_temp_control.setProgram(program);
+  return true;
+}
+
+HistorySample replayHistorySample(unsigned long now_msec) {
+  return toHistorySample(now_msec / 1000, s_temp_control.historyInput());
+}
+
+Probe probe() {
+  Probe p;
+  p.state = s_temp_control.state();
+  p.state_name = TempControl::state_names[p.state];
+  p.control_enabled = s_temp_control.enabled();
+  p.set_temp = s_temp_control.goalTemp();
+  p.target = s_pid.target().value();
+  p.filt_temp = s_temp_filter.value();
+  p.filt_d_temp = s_d_temp_filter.value();
+  p.heater_duty = s_pwm_heater.dutyF();
+  p.heater_enabled = s_pwm_safety.dutyF() > 0.0f;
+  p.fan = s_relay_fan.isHigh();
+  p.cmd_p = s_pid.p_term();
+  p.cmd_i = s_pid.i_term();
+  p.cmd_d = s_pid.d_term();
+  p.cmd_ff = s_pid.ff_term();
+  return p;
+}
+
+void printControlTiming(FILE* out) {
+  char line[96];
+  const ControlTiming& timing = s_temp_control.timing();
+  for (unsigned idx = 0; idx < ControlTiming::kNumStages; idx++) {
+    timing.format(static_cast<ControlTiming::Stage>(idx), line, sizeof(line));
+    fprintf(out, "%s\n", line);
+  }
+  timing.formatInterval(line, sizeof(line));
+  fprintf(out, "%s\n", line);
+}
+
+// Filters with the settings used on the control path, for --filter-bench.
+VariableGroup s_bench_vg("filter_bench");
+KernelFilter s_bench_kernel_temp(
+    {.name = "k_temp", .units = "", .description = "", .sigma = 20.0, .decimals = 2, .size = 20},
+    &s_app.module_system(), s_bench_vg);
+KernelFilter s_bench_kernel_d_temp(
+    {.name = "k_d_temp", .units = "", .description = "", .sigma = 15.0, .decimals = 2, .size = 15},
+    &s_app.module_system(), s_bench_vg);
+RecursiveFilter s_bench_recursive_temp(
+    {.name = "r_temp", .units = "", .description = "", .tau = 4.6, .stages = 2, .decimals = 2},
+    &s_app.module_system(), s_bench_vg);
+RecursiveFilter s_bench_recursive_d_temp(
+    {.name = "r_d_temp", .units = "", .description = "", .tau = 3.4, .stages = 2, .decimals = 2},
+    &s_app.module_system(), s_bench_vg);
+
+// Feed a 1 Hz ramp, then a constant with unit white noise, then a timing run.
+// Report the delay behind the ramp, the output noise, and the cost of addSample().
+template <typename Filter>
+void benchFilter(FILE* out, const char* name, Filter* filter) {
+  constexpr float kSlope = 0.01f;
+  constexpr int kRampSamples = 400;
+  constexpr int kNoiseSamples = 20000;
+  constexpr int kTimingSamples = 200000;
+  std::mt19937 rng(133);
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  double lag_sum = 0.0;
+  int lag_count = 0;
+  int t = 0;
+  for (; t < kRampSamples; t++) {
+    const float out_val = filter->addSample(t, kSlope * t);
+    if (t > kRampSamples / 2) {
+      lag_sum += (kSlope * t - out_val) / kSlope;
+      lag_count += 1;
+    }
+  }
+  const float level = kSlope * (kRampSamples - 1);
+  double sq_sum = 0.0;
+  int sq_count = 0;
+  for (int idx = 0; idx < kNoiseSamples; idx++, t++) {
+    const float err = filter->addSample(t, level + noise(rng)) - level;
+    if (idx > 200) {
+      sq_sum += err * err;
+      sq_count += 1;
+    }
+  }
+  float sink = 0.0f;
+  const uint32_t start_usec = timingUsec();
+  for (int idx = 0; idx < kTimingSamples; idx++, t++) {
+    sink += filter->addSample(t, (idx & 7) * 0.1f);
+  }
+  const uint32_t usec = timingUsec() - start_usec;
+  fprintf(out, "%-26s lag %5.2f s  noise %.3f  %6.1f ns/sample%s\n", name, lag_sum / lag_count,
+          std::sqrt(sq_sum / sq_count), usec * 1e3 / kTimingSamples, sink < 0.0f ? " " : "");
+}
+
+void printFilterBenchmark(FILE* out) {
+  fprintf(out, "filter benchmark (1 Hz samples, unit noise):\n");
+  benchFilter(out, "kernel sigma 20 size 20", &s_bench_kernel_temp);
+  benchFilter(out, "recursive tau 4.6 x2", &s_bench_recursive_temp);
+  benchFilter(out, "kernel sigma 15 size 15", &s_bench_kernel_d_temp);
+  benchFilter(out, "recursive tau 3.4 x2", &s_bench_recursive_d_temp);
+}
+
+void printThermalModel(FILE* out) {
+  const ThermalModel& model = s_temp_control.thermalModel();
+  fprintf(out,
+          "thermal model (%u updates): ff per deltaC %.4f +/- %.4f, ff per rate %.2f +/- %.2f, "
+          "rms residual %.4f\n",
+          model.numUpdates(), model.ffPerDeltaC(), model.ffPerDeltaCStddev(), model.ffPerRate(),
+          model.ffPerRateStddev(), model.rmsResidual());
+}
+
+void printAutotune(FILE* out) {
+  const RelayAutotune& autotune = s_temp_control.autotune();
+  const RelayAutotune::Result& result = autotune.result();
+  if (autotune.status() != RelayAutotune::Status::kDone) {
+    fprintf(out, "autotune did not finish (%u cycles)\n", autotune.cyclesDone());
+    return;
+  }
+  fprintf(out, "autotune: Ku=%.3f Tu=%.0fs amplitude=%.2fC -> kP=%.4f kI=%.6f kD=%.2f\n",
+          result.ku, result.tu_sec, result.amplitude, result.kp, result.ki, result.kd);
+}
+
+}  // namespace sim
+#endif
+
+template <typename Method>
+const char* methodName(Method method) {
+  return method == HTTP_GET    ? "GET"
+         : method == HTTP_POST ? "POST"
+         : method == HTTP_PUT  ? "PUT"
+                               : "?";
+}
+
+// Register a web handler, timing each request into s_perf.
+template <typename Method, typename Handler>
+void onRoute(const char* path, Method method, Handler handler) {
+  const unsigned route = s_perf.addRoute(methodName(method), path);
+  s_app.web_server_module().on(path, method,
+                               [route, handler](NetRequest* request, NetResponse* response) {
+                                 const uint32_t start_usec = timingUsec();
+                                 const NetHandlerStatus status = handler(request, response);
+                                 s_perf.addRequest(route, timingUsec() - start_usec);
+                                 return status;
+                               });
+}
+template <typename Method, typename Handler>
+void onJsonRoute(const char* path, Method method, Handler handler) {
+  const unsigned route = s_perf.addRoute(methodName(method), path);
+  s_app.web_server_module().onJson(
+      path, method,
+      [route, handler](NetRequest* request, NetResponse* response, JsonVariant& json) {
+        const uint32_t start_usec = timingUsec();
+        const NetHandlerStatus status = handler(request, response, json);
+        s_perf.addRequest(route, timingUsec() - start_usec);
+        return status;
+      });
+}
+
 }  // namespace og3
 
 void setup() {
+  og3::s_boot_setup_msec = micros() * 1e-3f;
+#ifndef NATIVE
+  og3::s_loop_task = xTaskGetCurrentTaskHandle();
+#endif
   Wire1.setPins(og3::kSda2, og3::kScl2);  // The room temp sensor uses this second i2c bus.
 
+#ifndef NATIVE
   initSvelteStaticFiles(&og3::s_app.web_server_module().native_server());
-  og3::s_app.web_server_module().on("/api/wifi", HTTP_GET, og3::apiGetWifi);
-  og3::s_app.web_server_module().on("/api/mqtt", HTTP_GET, og3::apiGetMqtt);
-  og3::s_app.web_server_module().on("/api/status", HTTP_GET, og3::apiGetStatus);
-  og3::s_app.web_server_module().on("/api/config", HTTP_GET, og3::apiGetConfig);
-
-  og3::s_app.web_server_module().onJson("/api/wifi", HTTP_PUT, og3::putWifiConfig);
-  og3::s_app.web_server_module().onJson("/api/mqtt", HTTP_PUT, og3::putMqttConfig);
-  og3::s_app.web_server_module().onJson("/api/config", HTTP_PUT, og3::putConfig);
-  og3::s_app.web_server_module().onJson("/api/target", HTTP_PUT, og3::apiPutTarget);
-
-  og3::s_app.web_server_module().on("/api/enable", HTTP_POST, og3::apiPostEnable);
-  og3::s_app.web_server_module().on("/api/disable", HTTP_POST, og3::apiPostDisable);
-  og3::s_app.web_server_module().on("/api/fan/on", HTTP_POST, og3::apiPostFanOn);
-  og3::s_app.web_server_module().on("/api/fan/off", HTTP_POST, og3::apiPostFanOff);
-  og3::s_app.web_server_module().on("/api/test_command", HTTP_POST, og3::apiPostTestCommand);
-
-  og3::s_app.web_server_module().on("/api/restart", HTTP_POST,
-                                    [](og3::NetRequest* request, og3::NetResponse* response) {
-                                      response->send(200, "text/plain", "restarting");
-                                      og3::s_app.tasks().runIn(1000, []() { ESP.restart(); });
-                                      NET_REPLY(request, ESP_OK);
-                                    });
-
-  og3::s_app.web_server_module().on("/old", HTTP_GET, og3::handleWebRoot);
-  og3::s_app.web_server_module().on("/old", HTTP_POST, og3::handleWebRoot);
-  og3::s_app.web_server_module().on("/old_config", HTTP_GET, og3::handleConfigure);
-  og3::s_app.web_server_module().on("/old_config", HTTP_POST, og3::handleConfigure);
-
-  og3::s_oled.setup();
+  og3::s_app.web_server_module().native_server().on("/api/events", &og3::s_status_events);
+#endif
+  og3::onRoute("/api/wifi", HTTP_GET, og3::apiGetWifi);
+  og3::onRoute("/api/mqtt", HTTP_GET, og3::apiGetMqtt);
+  og3::onRoute("/api/status", HTTP_GET, og3::apiGetStatus);
+  og3::onRoute("/api/config", HTTP_GET, og3::apiGetConfig);
+  og3::onRoute("/api/history", HTTP_GET, og3::apiGetHistory);
+  og3::onRoute("/api/trace", HTTP_GET, og3::apiGetTrace);
+  og3::onRoute("/api/perf", HTTP_GET, og3::apiGetPerf);
+  og3::onRoute("/api/program", HTTP_GET, og3::apiGetProgram);
+
+  og3::onJsonRoute("/api/wifi", HTTP_PUT, og3::putWifiConfig);
+  og3::onJsonRoute("/api/mqtt", HTTP_PUT, og3::putMqttConfig);
+  og3::onJsonRoute("/api/config", HTTP_PUT, og3::putConfig);
+  og3::onJsonRoute("/api/target", HTTP_PUT, og3::apiPutTarget);
+  og3::onJsonRoute("/api/program", HTTP_PUT, og3::apiPutProgram);
+
+  og3::onRoute("/api/enable", HTTP_POST, og3::apiPostEnable);
+  og3::onRoute("/api/disable", HTTP_POST, og3::apiPostDisable);
+  og3::onRoute("/api/fan/on", HTTP_POST, og3::apiPostFanOn);
+  og3::onRoute("/api/fan/off", HTTP_POST, og3::apiPostFanOff);
+  og3::onRoute("/api/test_command", HTTP_POST, og3::apiPostTestCommand);
+  og3::onRoute("/api/autotune", HTTP_POST, og3::apiPostAutotune);
+  og3::onRoute("/api/program/start", HTTP_POST, og3::apiPostProgramStart);
+  og3::onRoute("/api/program/stop", HTTP_POST, og3::apiPostProgramStop);
+
+  og3::onRoute("/api/restart", HTTP_POST, [](og3::NetRequest* request, og3::NetResponse* response) {
+    response->send(200, "text/plain", "restarting");
+#ifndef NATIVE
+    og3::s_app.tasks().runIn(1000, []() {
+      og3::s_config_persister.flush();
+      og3::s_trace.flushAndWait(1000);
+      ESP.restart();
+    });
+#endif
+    NET_REPLY(request, ESP_OK);
+  });
+
+  og3::onRoute("/old", HTTP_GET, og3::handleWebRoot);
+  og3::onRoute("/old", HTTP_POST, og3::handleWebRoot);
+  og3::onRoute("/old_config", HTTP_GET, og3::handleConfigure);
+  og3::onRoute("/old_config", HTTP_POST, og3::handleConfigure);
+
+  if (!og3::s_oled.setup()) {
+    og3::s_app.log().log("Failed to start display.");
+  }
   og3::s_oled.addDisplayFn([]() {
-    og3::s_oled.setFontSize(og3::Oled::kSixteenPt);
+    og3::s_oled.setFontSize(og3::OledPipeline::kSixteenPt);
     og3::s_oled.display(og3::s_app.board_cname());
   });
+#ifndef NATIVE
+  // The IP address, or the access point to join to set up Wi-Fi.
+  og3::s_oled.addDisplayFn([]() {
+    char text[og3::OledPipeline::kMaxText];
+    if (WiFi.status() == WL_CONNECTED) {
+      snprintf(text, sizeof(text), "WiFi\n%s", WiFi.localIP().toString().c_str());
+    } else if (WiFi.getMode() & WIFI_AP) {
+      snprintf(text, sizeof(text), "AP %s\n%s", WiFi.softAPSSID().c_str(),
+               WiFi.softAPIP().toString().c_str());
+    } else {
+      snprintf(text, sizeof(text), "No WiFi");
+    }
+    og3::s_oled.setFontSize(og3::OledPipeline::kTenPt);
+    og3::s_oled.display(text);
+  });
+#endif
 
   og3::s_app.setup();
-  og3::s_app.config().read_config(og3::s_cvg);
-  og3::s_app.config().read_config(og3::s_cmdvg);
-  og3::s_button_reader.read();  // read state of the button on startup.
+  // Load the app config from the binary snapshot, or from the JSON files if it is not usable.
+  const uint32_t config_start_usec = micros();
+  og3::s_config_snapshot.addGroup(og3::s_cvg);
+  og3::s_config_snapshot.addGroup(og3::s_cmdvg);
+#ifndef NATIVE
+  og3::s_boot_config_snapshot = og3::s_config_snapshot.load();
+#endif
+  if (!og3::s_boot_config_snapshot.value()) {
+    og3::s_app.config().read_config(og3::s_cvg);
+    og3::s_app.config().read_config(og3::s_cmdvg);
+#ifndef NATIVE
+    og3::s_config_snapshot.save();
+#endif
+  }
+  og3::s_boot_config_msec = (micros() - config_start_usec) * 1e-3f;
+  og3::s_config_persister.addGroup(og3::s_cvg);
+  og3::s_config_persister.addGroup(og3::s_cmdvg);
+  og3::s_config_persister.addGroup(og3::s_app.wifi_manager().variables());
+  og3::s_config_persister.addGroup(og3::s_app.mqtt_manager().variables());
+#ifndef NATIVE
+  if (!og3::s_trace.begin(millis(), esp_reset_reason())) {
+    og3::s_app.log().log("Failed to start trace log.");
+  } else if (og3::s_trace_inputs.value()) {
+    og3::s_tracing_inputs = true;
+    og3::traceConfig();
+  }
+  // Wall-clock time, so a resumed fermentation program can count the time it was off.
+  configTime(0, 0, "pool.ntp.org");
+#endif
+  og3::s_temp_control.loadProgram();
+  og3::s_button.begin();
+  og3::s_power_button = og3::s_button.pressed();
   og3::heaterOff();
-  // This should start the system reporting state: temperature, etc...
-  og3::s_temp_control.update();
+  if (!og3::s_sensor_task.begin()) {
+    og3::s_app.log().log("Failed to start sensor task.");
+  }
+  // A replay runs the first update from the trace.
+  if (!og3::replaying()) {
+    og3::firstUpdate(millis());
+  }
+  og3::s_boot_update_msec = micros() * 1e-3f;
+  if (!og3::s_ticker.begin()) {
+    og3::s_app.log().log("Failed to start control tick timer.");
+  }
 }
 
 void loop() {
+  const uint32_t start_usec = og3::timingUsec();
   og3::s_app.loop();
+  og3::s_ticker.poll();
 
-  // Detect button-down transition.
-  static unsigned s_button_count = 0;
-  const bool button_was_high = og3::s_button_reader.isHigh();
-  og3::s_button_reader.read();
-  if (!button_was_high && og3::s_button_reader.isHigh()) {
-    og3::s_temp_control.toggleEnable();
-    s_button_count += 1;
-    og3::s_app.log().logf("button -> high");
-  } else if (button_was_high && !og3::s_button_reader.isHigh()) {
-    og3::s_app.log().logf("button -> low");
+  // Button edges are queued by an interrupt; the pin is not read here.
+  og3::ButtonEvents::Event event;
+  while (og3::s_button.poll(millis(), &event)) {
+    og3::s_temp_control.onButton(event);
+  }
+  if (og3::s_power_button.value() != og3::s_button.pressed()) {
+    og3::s_power_button = og3::s_button.pressed();
   }
+  og3::s_perf.addLoop(og3::timingUsec() - start_usec);
 }
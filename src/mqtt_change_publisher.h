@@ -0,0 +1,147 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <og3/variable.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace og3 {
+
+// Publishes VariableGroups over MQTT only when they have changed.
+//
+// Each group has a set of watched values.  A group is sent when a watched value moves by
+//  more than its deadband since the group was last sent, when it is marked dirty (e.g. after
+//  a config change), when MQTT reconnects, or when its keepalive period expires.
+// The whole group is sent, since Home Assistant templates read fields from the group's JSON.
+// markDirty() may be called from the web server's task; everything else runs in the main loop.
+class MqttChangePublisher {
+ public:
+  using SendFn = std::function<bool(const VariableGroup& vg, unsigned flags)>;
+  using IsConnectedFn = std::function<bool()>;
+  using GetFn = std::function<float()>;
+
+  MqttChangePublisher(const SendFn& send_fn, const IsConnectedFn& is_connected_fn)
+      : m_send_fn(send_fn), m_is_connected_fn(is_connected_fn) {}
+
+  // Register a group, sent with the given variable flags (as for HAApp::mqttSend()).
+  void addGroup(const VariableGroup& vg, unsigned flags = 0) {
+    m_groups.emplace_back(&vg, flags);
+  }
+
+  // Send vg when get_fn() moves by more than *deadband.  If deadband is null, any change
+  //  counts.  The deadband is read each time, so it can be a config variable's value.
+  void watch(const VariableGroup& vg, const GetFn& get_fn, const float* deadband = nullptr) {
+    Group* group = find(vg);
+    if (group) {
+      group->watches.push_back(Watch{get_fn, deadband, std::nanf("")});
+    }
+  }
+  void watch(const VariableGroup& vg, const GetFn& get_fn, const FloatVariable& deadband) {
+    watch(vg, get_fn, &deadband.value());
+  }
+
+  void markDirty(const VariableGroup& vg) {
+    Group* group = find(vg);
+    if (group) {
+      group->dirty.store(true);
+    }
+  }
+  void markAllDirty() {
+    for (auto& group : m_groups) {
+      group.dirty.store(true);
+    }
+  }
+
+  // Send the groups which need it.  Call once per control tick.
+  void publish(unsigned long now_msec, unsigned long keepalive_msec) {
+    const bool connected = m_is_connected_fn();
+    if (connected && !m_was_connected) {
+      markAllDirty();  // The broker may have missed updates while disconnected.
+    }
+    m_was_connected = connected;
+    if (!connected) {
+      return;
+    }
+    for (auto& group : m_groups) {
+      const bool expired = !group.sent || now_msec - group.last_sent_msec >= keepalive_msec;
+      // Taken before sending, so a change marked during the send is sent next time.
+      const bool dirty = group.dirty.exchange(false);
+      if (!dirty && !expired && !changed(group)) {
+        m_num_skipped += 1;
+        continue;
+      }
+      if (!m_send_fn(*group.vg, group.flags)) {
+        if (dirty) {
+          group.dirty.store(true);  // Try again next time.
+        }
+        continue;
+      }
+      for (auto& watch : group.watches) {
+        watch.last_sent = watch.get_fn();
+      }
+      group.sent = true;
+      group.last_sent_msec = now_msec;
+      m_num_sent += 1;
+    }
+  }
+
+  uint32_t numSent() const { return m_num_sent; }
+  uint32_t numSkipped() const { return m_num_skipped; }
+
+ private:
+  struct Watch {
+    GetFn get_fn;
+    const float* deadband;
+    float last_sent;
+  };
+  struct Group {
+    Group(const VariableGroup* vg_in, unsigned flags_in) : vg(vg_in), flags(flags_in) {}
+
+    const VariableGroup* vg;
+    unsigned flags;
+    std::vector<Watch> watches;
+    std::atomic<bool> dirty{true};
+    bool sent = false;
+    unsigned long last_sent_msec = 0;
+  };
+
+  Group* find(const VariableGroup& vg) {
+    for (auto& group : m_groups) {
+      if (group.vg == &vg) {
+        return &group;
+      }
+    }
+    return nullptr;
+  }
+
+  static bool changed(const Group& group) {
+    for (const auto& watch : group.watches) {
+      const float val = watch.get_fn();
+      if (std::isnan(val) != std::isnan(watch.last_sent)) {
+        return true;
+      }
+      const float deadband = watch.deadband ? *watch.deadband : 0.0f;
+      if (deadband > 0.0f ? std::abs(val - watch.last_sent) > deadband
+                          : val != watch.last_sent && !std::isnan(val)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const SendFn m_send_fn;
+  const IsConnectedFn m_is_connected_fn;
+  std::deque<Group> m_groups;  // Groups hold an atomic, so they are not moved.
+  bool m_was_connected = false;
+  uint32_t m_num_sent = 0;
+  uint32_t m_num_skipped = 0;
+};
+
+}  // namespace og3
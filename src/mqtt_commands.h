@@ -0,0 +1,272 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "spsc_ring.h"
+
+namespace og3 {
+
+// A command received over MQTT: the fields set in `fields` are to be applied.
+// A batch (see MqttCommandRouter::onBatch()) sets several fields, which the control tick
+//  applies together.
+struct MqttCommand {
+  enum Field : uint8_t { kMode = 1, kFanMode = 2, kSetTemp = 4, kProgram = 8 };
+
+  uint8_t fields = 0;
+  bool enable = false;         // kMode: "heat" or "off"
+  bool fan_high = false;       // kFanMode: "high" or "off"
+  bool program_start = false;  // kProgram: "start" or "stop"
+  float set_temp = 0.0f;       // kSetTemp
+};
+
+// Payload parsing, on (payload, len) in place: MQTT payloads are not NUL-terminated.
+namespace mqtt_command {
+
+inline bool equals(const char* payload, size_t len, const char* word) {
+  return len == strlen(word) && 0 == memcmp(payload, word, len);
+}
+
+inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+// A decimal number such as "26", "-1.5" or " 27.25 ", without an exponent.
+inline bool parseFloat(const char* payload, size_t len, float* out) {
+  const char* p = payload;
+  const char* end = payload + len;
+  while (p < end && isSpace(*p)) {
+    p++;
+  }
+  while (end > p && isSpace(end[-1])) {
+    end--;
+  }
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p++ == '-';
+  }
+  float value = 0.0f;
+  float scale = 0.0f;  // 0 before the decimal point
+  unsigned digits = 0;
+  for (; p < end; p++) {
+    if (*p >= '0' && *p <= '9') {
+      if (scale == 0.0f) {
+        value = value * 10.0f + (*p - '0');
+      } else {
+        value += (*p - '0') * scale;
+        scale *= 0.1f;
+      }
+      digits++;
+    } else if (*p == '.' && scale == 0.0f) {
+      scale = 0.1f;
+    } else {
+      return false;
+    }
+  }
+  if (digits == 0) {
+    return false;
+  }
+  *out = negative ? -value : value;
+  return true;
+}
+
+inline const char* parseMode(const char* payload, size_t len, MqttCommand* out) {
+  if (equals(payload, len, "heat") || equals(payload, len, "off")) {
+    out->enable = payload[0] == 'h';
+    out->fields |= MqttCommand::kMode;
+    return nullptr;
+  }
+  return "unknown mode";
+}
+
+inline const char* parseFanMode(const char* payload, size_t len, MqttCommand* out) {
+  if (equals(payload, len, "high") || equals(payload, len, "off")) {
+    out->fan_high = payload[0] == 'h';
+    out->fields |= MqttCommand::kFanMode;
+    return nullptr;
+  }
+  return "unknown fan mode";
+}
+
+inline const char* parseSetTemp(const char* payload, size_t len, MqttCommand* out) {
+  if (!parseFloat(payload, len, &out->set_temp)) {
+    return "failed to parse temperature";
+  }
+  out->fields |= MqttCommand::kSetTemp;
+  return nullptr;
+}
+
+inline const char* parseProgram(const char* payload, size_t len, MqttCommand* out) {
+  if (equals(payload, len, "start") || equals(payload, len, "stop")) {
+    out->program_start = payload[2] == 'a';
+    out->fields |= MqttCommand::kProgram;
+    return nullptr;
+  }
+  return "unknown program command";
+}
+
+}  // namespace mqtt_command
+
+// A command topic: "<key>/set", and the key of the same command in a batch.
+struct MqttCommandRoute {
+  const char* key;
+  const char* topic;
+  // Parse the payload into out.  Returns nullptr, or a description of the problem.
+  const char* (*parse)(const char* payload, size_t len, MqttCommand* out);
+};
+
+constexpr MqttCommandRoute kMqttCommandRoutes[] = {
+    {"mode", "mode/set", mqtt_command::parseMode},
+    {"fan_mode", "fan_mode/set", mqtt_command::parseFanMode},
+    {"set_temp", "set_temp/set", mqtt_command::parseSetTemp},
+    {"program", "program/set", mqtt_command::parseProgram},
+};
+// A JSON object with any of the keys above, e.g. {"mode": "heat", "set_temp": 26.5}.
+constexpr char kMqttBatchTopic[] = "command/set";
+
+// Parses MQTT commands in the MQTT client's task and queues them for the control tick.
+//
+// The handlers parse the payload where it is, and only the parsed MqttCommand (a few bytes) is
+//  queued, in a lock-free ring.  Nothing is applied in the MQTT callback: the control tick
+//  takes the commands with poll(), so they are applied between control updates, in the order
+//  received, and a batch is applied in one tick.
+class MqttCommandRouter {
+ public:
+  static constexpr size_t kQueueSize = 8;
+
+  // Returns nullptr, or a description of the problem.
+  const char* onMessage(const MqttCommandRoute& route, const char* payload, size_t len) {
+    MqttCommand command;
+    return queue(route.parse(payload, len, &command), command);
+  }
+
+  // A flat JSON object whose keys are those of kMqttCommandRoutes, each at most once, and
+  //  nothing after it.  String values are given to the parsers without their quotes, and
+  //  other values as they are.  No escapes.
+  const char* onBatch(const char* payload, size_t len) {
+    using mqtt_command::isSpace;
+    const char* p = payload;
+    const char* const end = payload + len;
+    auto skipSpace = [&p, end]() {
+      while (p < end && isSpace(*p)) {
+        p++;
+      }
+    };
+    MqttCommand command;
+    skipSpace();
+    if (p == end || *p++ != '{') {
+      return queue("not a JSON object", command);
+    }
+    skipSpace();
+    if (p < end && *p == '}') {
+      return queue("empty command", command);
+    }
+    while (p < end) {
+      const char* key = nullptr;
+      size_t key_len = 0;
+      if (!readString(&p, end, &key, &key_len)) {
+        return queue("bad key", command);
+      }
+      skipSpace();
+      if (p == end || *p++ != ':') {
+        return queue("expected ':'", command);
+      }
+      skipSpace();
+      const char* value = p;
+      size_t value_len = 0;
+      if (p < end && *p == '"') {
+        if (!readString(&p, end, &value, &value_len)) {
+          return queue("bad value", command);
+        }
+      } else {
+        while (p < end && *p != ',' && *p != '}' && !isSpace(*p)) {
+          p++;
+        }
+        value_len = p - value;
+      }
+      const MqttCommandRoute* route = findRoute(key, key_len);
+      if (!route) {
+        return queue("unknown key", command);
+      }
+      const uint8_t fields_before = command.fields;
+      if (const char* error = route->parse(value, value_len, &command)) {
+        return queue(error, command);
+      }
+      if (command.fields == fields_before) {
+        return queue("repeated key", command);
+      }
+      skipSpace();
+      if (p < end && *p == ',') {
+        p++;
+        skipSpace();
+      } else if (p < end && *p == '}') {
+        p++;
+        skipSpace();
+        return queue(p == end ? nullptr : "trailing characters", command);
+      } else {
+        break;
+      }
+    }
+    return queue("unterminated object", command);
+  }
+
+  // Control tick: take the oldest queued command.
+  bool poll(MqttCommand* out) { return m_queue.pop(out); }
+
+  uint32_t numQueued() const { return m_num_queued.load(); }
+  uint32_t numErrors() const { return m_num_errors.load(); }
+  // Commands lost because the control tick did not take them in time.
+  uint32_t numDropped() const { return m_num_dropped.load(); }
+
+ private:
+  static const MqttCommandRoute* findRoute(const char* key, size_t len) {
+    for (const MqttCommandRoute& route : kMqttCommandRoutes) {
+      if (mqtt_command::equals(key, len, route.key)) {
+        return &route;
+      }
+    }
+    return nullptr;
+  }
+
+  // A quoted string at *p: sets out/out_len to its contents and moves *p past it.
+  static bool readString(const char** p, const char* end, const char** out, size_t* out_len) {
+    if (*p == end || **p != '"') {
+      return false;
+    }
+    const char* start = *p + 1;
+    const char* close = start;
+    while (close < end && *close != '"' && *close != '\\') {
+      close++;
+    }
+    if (close == end || *close != '"') {
+      return false;
+    }
+    *out = start;
+    *out_len = close - start;
+    *p = close + 1;
+    return true;
+  }
+
+  const char* queue(const char* error, const MqttCommand& command) {
+    if (error) {
+      m_num_errors.fetch_add(1);
+      return error;
+    }
+    if (!m_queue.push(command)) {
+      m_num_dropped.fetch_add(1);
+      return "command queue full";
+    }
+    m_num_queued.fetch_add(1);
+    return nullptr;
+  }
+
+  SpscRing<MqttCommand, kQueueSize> m_queue;
+  std::atomic<uint32_t> m_num_queued{0};
+  std::atomic<uint32_t> m_num_errors{0};
+  std::atomic<uint32_t> m_num_dropped{0};
+};
+
+}  // namespace og3
@@ -0,0 +1,267 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <og3/tasks.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#ifndef NATIVE
+#include <Arduino.h>
+#include <SSD1306Wire.h>
+#include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+#include "spsc_ring.h"
+
+namespace og3 {
+
+// A 128x64 SSD1306 display, drawn on the main loop and sent to the panel by a task.
+//
+// Like og3's OledDisplayRing, display functions take turns on the screen every switch_msec,
+//  but the current one is also called every refresh_msec so the screen follows the state.
+//  display() only renders when the text or font changed, into a framebuffer which is passed
+//  to a low-priority FreeRTOS task through a lock-free ring.  The task compares each frame with
+//  the one last sent, and for each 8-pixel page sends only the columns which changed, so an
+//  unchanged screen costs no I2C traffic and a changed temperature a few dozen bytes rather
+//  than the whole 1 KiB frame.  The main loop never waits for the bus.
+// On the host (NATIVE) there is no panel and display() just keeps the text.
+class OledPipeline {
+ public:
+  enum FontSize : uint8_t { kTenPt, kSixteenPt };
+
+  static constexpr unsigned kWidth = 128;
+  static constexpr unsigned kPages = 8;  // rows of 8 pixels
+  static constexpr size_t kMaxText = 48;
+
+  // Pixels as the SSD1306 stores them: page-major, one byte for 8 vertical pixels.
+  struct Frame {
+    uint8_t bytes[kPages * kWidth];
+  };
+  // The changed columns [first, last] of a page, if first <= last.
+  struct Span {
+    uint8_t first;
+    uint8_t last;
+  };
+
+  // Find the changed columns of each page of next relative to sent.
+  //  Returns the number of pages with changes.
+  static unsigned diff(const Frame& next, const Frame& sent, Span spans[kPages]) {
+    unsigned changed = 0;
+    for (unsigned page = 0; page < kPages; page++) {
+      const uint8_t* a = next.bytes + page * kWidth;
+      const uint8_t* b = sent.bytes + page * kWidth;
+      unsigned first = 0;
+      while (first < kWidth && a[first] == b[first]) {
+        first++;
+      }
+      if (first == kWidth) {
+        spans[page] = {1, 0};
+        continue;
+      }
+      unsigned last = kWidth - 1;
+      while (a[last] == b[last]) {
+        last--;
+      }
+      spans[page] = {static_cast<uint8_t>(first), static_cast<uint8_t>(last)};
+      changed++;
+    }
+    return changed;
+  }
+
+  struct Options {
+    unsigned long switch_msec;   // time each display function has the screen
+    unsigned long refresh_msec;  // how often the current display function is called
+    uint8_t address;             // I2C address of the panel
+    uint32_t i2c_hz;
+  };
+
+  OledPipeline(const Options& options, Tasks* tasks)
+      : m_options(options),
+        m_scheduler(tasks)
+#ifndef NATIVE
+        ,
+        m_screen(options.address, -1, -1, GEOMETRY_128_64, I2C_ONE, options.i2c_hz)
+#endif
+  {
+  }
+
+  // Call from setup().  Sets up the panel and starts the task.
+  bool setup() {
+    m_scheduler.runIn(m_options.refresh_msec, [this]() { refresh(); });
+#ifndef NATIVE
+    if (!m_screen.init()) {
+      return false;
+    }
+    memset(m_sent.bytes, 0, sizeof(m_sent.bytes));  // init() clears the panel.
+    return pdPASS == xTaskCreatePinnedToCore(sendTask, "display", kTaskStack, this,
+                                             tskIDLE_PRIORITY + 1, &m_task,
+                                             xPortGetCoreID() == 0 ? 1 : 0);
+#else
+    return true;
+#endif
+  }
+
+  // Returns the index of the function, for select().
+  unsigned addDisplayFn(const std::function<void()>& fn) {
+    m_fns.push_back(fn);
+    return m_fns.size() - 1;
+  }
+  // Give the screen to display function idx now, for the whole of switch_msec.
+  void select(unsigned idx) {
+    if (idx < m_fns.size()) {
+      m_index = idx;
+      m_switch_count = 0;
+      m_fns[idx]();
+    }
+  }
+
+  void setFontSize(FontSize font_size) { m_font_size = font_size; }
+
+  // Show text, with lines separated by '\n'.  Does nothing if the screen already shows it.
+  void display(const char* text) {
+    if (m_font_size == m_shown_font_size && 0 == strncmp(text, m_shown, sizeof(m_shown))) {
+      m_num_skipped.fetch_add(1);
+      return;
+    }
+#ifndef NATIVE
+    m_screen.clear();
+    m_screen.setFont(m_font_size == kTenPt ? ArialMT_Plain_10 : ArialMT_Plain_16);
+    m_screen.setTextAlignment(TEXT_ALIGN_LEFT);
+    m_screen.drawString(0, 0, text);
+    memcpy(m_frame.bytes, m_screen.buffer, sizeof(m_frame.bytes));
+    if (!m_task || !m_frames.push(m_frame)) {
+      return;  // The task is behind: try again on the next refresh.
+    }
+    xTaskNotifyGive(m_task);
+#endif
+    m_shown_font_size = m_font_size;
+    strncpy(m_shown, text, sizeof(m_shown) - 1);
+    m_shown[sizeof(m_shown) - 1] = 0;
+    m_num_renders.fetch_add(1);
+  }
+
+  const char* text() const { return m_shown; }
+
+  // Frames rendered, display() calls which changed nothing, and what the task sent.
+  uint32_t numRenders() const { return m_num_renders.load(); }
+  uint32_t numSkipped() const { return m_num_skipped.load(); }
+  uint32_t numPagesSent() const { return m_num_pages.load(); }
+  uint32_t numBytesSent() const { return m_num_bytes.load(); }
+  uint32_t maxSendUsec() const { return m_max_send_usec.load(); }
+#ifndef NATIVE
+  TaskHandle_t task() const { return m_task; }
+#endif
+
+ private:
+  void refresh() {
+    m_scheduler.runIn(m_options.refresh_msec, [this]() { refresh(); });
+    if (m_fns.empty()) {
+      return;
+    }
+    const unsigned refreshes_per_switch =
+        std::max(1ul, m_options.switch_msec / m_options.refresh_msec);
+    if (++m_switch_count >= refreshes_per_switch) {
+      m_switch_count = 0;
+      m_index = (m_index + 1) % m_fns.size();
+    }
+    m_fns[m_index]();
+  }
+
+#ifndef NATIVE
+  static constexpr uint32_t kTaskStack = 2048;
+  static constexpr unsigned kRetryMsec = 1000;
+  static constexpr uint8_t kControlCommands = 0x00;
+  static constexpr uint8_t kControlData = 0x40;
+  static constexpr uint8_t kColumnAddr = 0x21;
+  static constexpr uint8_t kPageAddr = 0x22;
+  static constexpr unsigned kDataChunk = 32;  // bytes per transaction, within the Wire buffer
+
+  // Wait for a frame and send it.  After an I2C error the frame is sent again (or a newer one
+  //  if there is one) after kRetryMsec.
+  static void sendTask(void* arg) {
+    auto* self = static_cast<OledPipeline*>(arg);
+    bool failed = false;
+    while (true) {
+      ulTaskNotifyTake(pdTRUE, failed ? pdMS_TO_TICKS(kRetryMsec) : portMAX_DELAY);
+      self->m_frames.popLatest(&self->m_next);
+      failed = !self->send();
+    }
+  }
+
+  // Send the changed part of each page of m_next.  Each I2C transaction locks the bus on its
+  //  own, so the sensor task can measure between them.
+  bool send() {
+    const uint32_t start_usec = micros();
+    Span spans[kPages];
+    if (0 == diff(m_next, m_sent, spans)) {
+      return true;
+    }
+    for (unsigned page = 0; page < kPages; page++) {
+      const Span& span = spans[page];
+      if (span.first > span.last) {
+        continue;
+      }
+      const uint8_t page_addr = page;
+      const uint8_t commands[] = {kColumnAddr, span.first, span.last, kPageAddr, page_addr,
+                                  page_addr};
+      Wire.beginTransmission(m_options.address);
+      Wire.write(kControlCommands);
+      Wire.write(commands, sizeof(commands));
+      if (0 != Wire.endTransmission()) {
+        return false;  // m_sent is unchanged, so the page is sent again.
+      }
+      const uint8_t* data = m_next.bytes + page * kWidth;
+      for (unsigned col = span.first; col <= span.last; col += kDataChunk) {
+        const unsigned len = std::min<unsigned>(kDataChunk, span.last + 1 - col);
+        Wire.beginTransmission(m_options.address);
+        Wire.write(kControlData);
+        Wire.write(data + col, len);
+        if (0 != Wire.endTransmission()) {
+          return false;
+        }
+        memcpy(m_sent.bytes + page * kWidth + col, data + col, len);
+        m_num_bytes.fetch_add(len);
+      }
+      m_num_pages.fetch_add(1);
+    }
+    const uint32_t usec = micros() - start_usec;
+    if (usec > m_max_send_usec.load()) {
+      m_max_send_usec.store(usec);
+    }
+    return true;
+  }
+#endif
+
+  const Options m_options;
+  TaskIdScheduler m_scheduler;
+#ifndef NATIVE
+  SSD1306Wire m_screen;
+  Frame m_frame;  // main loop
+  SpscRing<Frame, 2> m_frames;
+  Frame m_next;  // task
+  Frame m_sent;  // task: what the panel shows
+  TaskHandle_t m_task = nullptr;
+#endif
+  std::vector<std::function<void()>> m_fns;
+  unsigned m_index = 0;
+  unsigned m_switch_count = 0;
+  FontSize m_font_size = kTenPt;
+  FontSize m_shown_font_size = kTenPt;
+  char m_shown[kMaxText] = {};
+  std::atomic<uint32_t> m_num_renders{0};
+  std::atomic<uint32_t> m_num_skipped{0};
+  std::atomic<uint32_t> m_num_pages{0};
+  std::atomic<uint32_t> m_num_bytes{0};
+  std::atomic<uint32_t> m_max_send_usec{0};
+};
+
+}  // namespace og3
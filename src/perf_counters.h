@@ -0,0 +1,74 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+#include "latency_histogram.h"
+
+namespace og3 {
+
+// Runtime performance counters, cheap enough to leave on in production.
+//
+// All storage is fixed: one LatencyHistogram (about 0.5KB) per HTTP route, up to kMaxRoutes,
+//  one for the main loop, and plain counters for MQTT.  Recording is an increment or two, with
+//  no locks: routes are recorded by the web server's task and the rest by the main loop, so a
+//  report taken while a sample is being added may be off by that one sample.
+class PerfCounters {
+ public:
+  static constexpr unsigned kMaxRoutes = 28;
+  static constexpr unsigned kRouteNameSize = 32;
+
+  struct Route {
+    char name[kRouteNameSize];  // e.g. "GET /api/status"
+    LatencyHistogram usec;
+  };
+
+  // Register an HTTP route.  Returns its index, or kMaxRoutes if the table is full.
+  unsigned addRoute(const char* method, const char* path) {
+    if (m_num_routes >= kMaxRoutes) {
+      return kMaxRoutes;
+    }
+    snprintf(m_routes[m_num_routes].name, kRouteNameSize, "%s %s", method, path);
+    return m_num_routes++;
+  }
+  void addRequest(unsigned route, uint32_t usec) {
+    if (route < m_num_routes) {
+      m_routes[route].usec.add(usec);
+    }
+  }
+
+  void addLoop(uint32_t usec) { m_loop_usec.add(usec); }
+
+  void addMqttSend(size_t bytes) {
+    m_mqtt_sends += 1;
+    m_mqtt_bytes += bytes;
+  }
+
+  // Restart the histograms and counters (routes stay registered).
+  void clear() {
+    for (unsigned idx = 0; idx < m_num_routes; idx++) {
+      m_routes[idx].usec.clear();
+    }
+    m_loop_usec.clear();
+    m_mqtt_sends = 0;
+    m_mqtt_bytes = 0;
+  }
+
+  unsigned numRoutes() const { return m_num_routes; }
+  const Route& route(unsigned idx) const { return m_routes[idx]; }
+  const LatencyHistogram& loopUsec() const { return m_loop_usec; }
+  uint32_t mqttSends() const { return m_mqtt_sends; }
+  uint32_t mqttBytes() const { return m_mqtt_bytes; }
+
+ private:
+  Route m_routes[kMaxRoutes];
+  unsigned m_num_routes = 0;
+  LatencyHistogram m_loop_usec;
+  uint32_t m_mqtt_sends = 0;
+  uint32_t m_mqtt_bytes = 0;
+};
+
+}  // namespace og3
@@ -0,0 +1,82 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <og3/variable.h>
+
+#include <cmath>
+
+namespace og3 {
+
+class ModuleSystem;
+
+// A low-pass filter with a constant cost per sample, for use in place of KernelFilter on the
+//  control path.
+//
+// It is a cascade of first-order exponential smoothers with time constant tau.  The impulse
+//  response of n stages is a gamma distribution (a Gaussian-like bump for n >= 2) with a delay
+//  of n * tau for a ramp, and white noise is reduced about as much as by a kernel window with
+//  the same delay.  KernelFilter re-weights its whole window on every sample; this filter does
+//  one multiply-add per stage, plus an exp() only when the sample interval changes.
+// addSample() and value() match KernelFilter, so the two can be swapped.
+class RecursiveFilter {
+ public:
+  static constexpr unsigned kMaxStages = 4;
+
+  struct Options {
+    const char* name;
+    const char* units;
+    const char* description;
+    unsigned var_flags;
+    float tau;        // seconds, per stage
+    unsigned stages;  // 1 .. kMaxStages
+    unsigned decimals;
+  };
+
+  RecursiveFilter(const Options& opts, ModuleSystem* /*module_system*/, VariableGroup& vg)
+      : m_tau(opts.tau),
+        m_stages(opts.stages < 1 ? 1 : opts.stages > kMaxStages ? kMaxStages : opts.stages),
+        m_value(opts.name, 0.0f, opts.units, opts.description, opts.var_flags, opts.decimals,
+                vg) {}
+
+  // Add a sample at time t_sec and return the new filtered value.
+  float addSample(float t_sec, float value) {
+    if (!m_initialized) {
+      for (unsigned idx = 0; idx < m_stages; idx++) {
+        m_state[idx] = value;
+      }
+      m_initialized = true;
+    } else {
+      const float dt = t_sec - m_last_sec;
+      if (dt != m_last_dt) {
+        m_alpha = dt > 0.0f ? 1.0f - std::exp(-dt / m_tau) : 0.0f;
+        m_last_dt = dt;
+      }
+      float in = value;
+      for (unsigned idx = 0; idx < m_stages; idx++) {
+        m_state[idx] += m_alpha * (in - m_state[idx]);
+        in = m_state[idx];
+      }
+    }
+    m_last_sec = t_sec;
+    m_value = m_state[m_stages - 1];
+    return m_value.value();
+  }
+
+  float value() const { return m_value.value(); }
+  // Delay of the output behind a ramp, in seconds.
+  float lagSec() const { return m_stages * m_tau; }
+
+ private:
+  const float m_tau;
+  const unsigned m_stages;
+  FloatVariable m_value;
+  float m_state[kMaxStages] = {};
+  float m_last_sec = 0.0f;
+  float m_last_dt = -1.0f;
+  float m_alpha = 0.0f;
+  bool m_initialized = false;
+};
+
+}  // namespace og3
@@ -0,0 +1,142 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+namespace og3 {
+
+// Relay-feedback PID autotuning (Åström and Hägglund).
+//
+// The heater is switched between output_high and output_low whenever the temperature crosses
+//  setpoint +/- hysteresis.  This drives a steady oscillation at the plant's ultimate period
+//  Tu, with an amplitude a which gives the ultimate gain Ku = 4d / (pi * sqrt(a^2 - eps^2)),
+//  where d is half the relay step and eps the hysteresis.
+// The first cycle (which includes the approach to the setpoint) is discarded, and the next
+//  `cycles` cycles are averaged.  Gains follow the Ziegler-Nichols "no overshoot" rule
+//  (Kp = 0.2 Ku, Ti = Tu / 2, Td = Tu / 3), since overshoot is worse than a slow approach
+//  for dough.
+class RelayAutotune {
+ public:
+  struct Options {
+    float setpoint;
+    float output_high;  // heater duty while the temperature is low
+    float output_low;   // heater duty while the temperature is high
+    float hysteresis;   // °C
+    unsigned cycles;
+    unsigned long max_msec;  // give up if not done in this long
+  };
+  enum class Status { kIdle, kRunning, kDone, kFailed };
+  struct Result {
+    float ku = 0.0f;  // pwm/°C
+    float tu_sec = 0.0f;
+    float amplitude = 0.0f;  // °C, half the peak-to-peak swing
+    float kp = 0.0f;
+    float ki = 0.0f;
+    float kd = 0.0f;
+  };
+
+  void start(const Options& options, unsigned long now_msec) {
+    m_options = options;
+    m_status = Status::kRunning;
+    m_start_msec = now_msec;
+    m_started = false;
+    m_num_switches = 0;
+    m_num_cycles = 0;
+    m_sum_period_sec = 0.0f;
+    m_sum_amplitude = 0.0f;
+    m_result = Result();
+  }
+  void stop() { m_status = Status::kIdle; }
+
+  // Returns the heater output for this temperature.  Check status() afterwards.
+  float update(unsigned long now_msec, float temp) {
+    if (m_status != Status::kRunning) {
+      return 0.0f;
+    }
+    if (now_msec - m_start_msec > m_options.max_msec || std::isnan(temp)) {
+      m_status = Status::kFailed;
+      return 0.0f;
+    }
+    if (!m_started) {
+      m_high = temp < m_options.setpoint;
+      m_started = true;
+      m_max = m_min = temp;
+    }
+    // The peak comes after switching low (and the trough after switching high), so the
+    //  maximum is tracked while low and the minimum while high.
+    if (m_high) {
+      m_min = std::min(m_min, temp);
+      if (temp > m_options.setpoint + m_options.hysteresis) {
+        m_high = false;
+        endCycle(now_msec);
+        m_max = temp;
+      }
+    } else {
+      m_max = std::max(m_max, temp);
+      if (temp < m_options.setpoint - m_options.hysteresis) {
+        m_high = true;
+        m_min = temp;
+      }
+    }
+    return m_high ? m_options.output_high : m_options.output_low;
+  }
+
+  Status status() const { return m_status; }
+  bool running() const { return m_status == Status::kRunning; }
+  const Result& result() const { return m_result; }
+  unsigned cyclesDone() const { return m_num_cycles; }
+
+ private:
+  // A cycle runs from one high->low switch to the next.
+  void endCycle(unsigned long now_msec) {
+    m_num_switches += 1;
+    const unsigned long period_msec = now_msec - m_last_switch_msec;
+    m_last_switch_msec = now_msec;
+    if (m_num_switches <= 2) {
+      return;  // Discard the approach to the setpoint and the first (transient) cycle.
+    }
+    m_sum_period_sec += period_msec * 1e-3f;
+    m_sum_amplitude += 0.5f * (m_max - m_min);
+    m_num_cycles += 1;
+    if (m_num_cycles >= m_options.cycles) {
+      finish();
+    }
+  }
+
+  void finish() {
+    constexpr float kPi = 3.14159265f;
+    const float amplitude = m_sum_amplitude / m_num_cycles;
+    const float eps = m_options.hysteresis;
+    const float d = 0.5f * std::abs(m_options.output_high - m_options.output_low);
+    if (amplitude <= eps || d <= 0.0f) {
+      m_status = Status::kFailed;
+      return;
+    }
+    m_result.amplitude = amplitude;
+    m_result.tu_sec = m_sum_period_sec / m_num_cycles;
+    m_result.ku = 4.0f * d / (kPi * std::sqrt(amplitude * amplitude - eps * eps));
+    m_result.kp = 0.2f * m_result.ku;
+    m_result.ki = m_result.kp / (0.5f * m_result.tu_sec);
+    m_result.kd = m_result.kp * m_result.tu_sec / 3.0f;
+    m_status = Status::kDone;
+  }
+
+  Options m_options = {};
+  Status m_status = Status::kIdle;
+  Result m_result;
+  unsigned long m_start_msec = 0;
+  unsigned long m_last_switch_msec = 0;
+  bool m_started = false;
+  bool m_high = false;
+  float m_max = 0.0f;
+  float m_min = 0.0f;
+  unsigned m_num_switches = 0;
+  unsigned m_num_cycles = 0;
+  float m_sum_period_sec = 0.0f;
+  float m_sum_amplitude = 0.0f;
+};
+
+}  // namespace og3
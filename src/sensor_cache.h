@@ -0,0 +1,109 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+#ifndef NATIVE
+#include <freertos/FreeRTOS.h>
+#endif
+
+#include "sensor_task.h"
+
+namespace og3 {
+
+// A read-through cache of the latest SensorSample, shared by every consumer of the sensors.
+//
+// The control tick calls refresh() to take the newest sample.  Other consumers on the main loop,
+//  such as the display, call get(), which reads through only if the cached sample is
+//  max_age_msec old or more.  Every consumer sees the same values, along with the time they
+//  were measured.
+// refresh() and get() pop the sensor task's single-consumer ring, so they are for the main loop
+//  only.  Other tasks (the web API) call published(), a copy of the last sample taken, which is
+//  made under a lock and never reads through.
+class SensorCache {
+ public:
+  // Takes a new sample if one is available.
+  using ReadFn = std::function<bool(SensorSample*)>;
+  // Called with each sample taken into the cache.
+  using SampleFn = std::function<void(const SensorSample&)>;
+
+  SensorCache(const ReadFn& read_fn, const SampleFn& sample_fn)
+      : m_read_fn(read_fn), m_sample_fn(sample_fn) {}
+
+  // Take a new sample into the cache if there is one.
+  bool refresh() {
+    SensorSample sample;
+    m_num_reads.fetch_add(1);
+    if (!m_read_fn(&sample)) {
+      return false;
+    }
+    m_sample = sample;
+    lock();
+    publish(sample);
+    unlock();
+    m_sample_fn(m_sample);
+    return true;
+  }
+
+  // Main loop: the cached sample, refreshed first if it is max_age_msec old or more.
+  const SensorSample& get(unsigned long now_msec, unsigned long max_age_msec) {
+    if (m_num_reads == 0 || ageMsec(now_msec) >= max_age_msec) {
+      refresh();
+    } else {
+      m_num_hits.fetch_add(1);
+    }
+    return m_sample;
+  }
+
+  // Main loop: the cached sample.
+  const SensorSample& sample() const { return m_sample; }
+  // Any task: a copy of the last sample taken, in which a sensor that failed keeps its last
+  //  good values, as the sensor modules' variables do.
+  SensorSample published() const {
+    lock();
+    const SensorSample sample = m_published;
+    unlock();
+    return sample;
+  }
+  unsigned long ageMsec(unsigned long now_msec) const { return now_msec - m_sample.msec; }
+
+  uint32_t numReads() const { return m_num_reads.load(); }
+  uint32_t numHits() const { return m_num_hits.load(); }
+
+ private:
+#ifndef NATIVE
+  void lock() const { portENTER_CRITICAL(&m_mux); }
+  void unlock() const { portEXIT_CRITICAL(&m_mux); }
+  mutable portMUX_TYPE m_mux = portMUX_INITIALIZER_UNLOCKED;
+#else
+  void lock() const {}
+  void unlock() const {}
+#endif
+
+  void publish(const SensorSample& sample) {
+    m_published.msec = sample.msec;
+    m_published.enclosure_ok = sample.enclosure_ok;
+    m_published.room_ok = sample.room_ok;
+    if (sample.enclosure_ok) {
+      m_published.enclosure_temp = sample.enclosure_temp;
+      m_published.enclosure_humidity = sample.enclosure_humidity;
+    }
+    if (sample.room_ok) {
+      m_published.room_temp = sample.room_temp;
+      m_published.room_humidity = sample.room_humidity;
+    }
+  }
+
+  const ReadFn m_read_fn;
+  const SampleFn m_sample_fn;
+  SensorSample m_sample;     // main loop
+  SensorSample m_published;  // guarded by m_mux
+  std::atomic<uint32_t> m_num_reads{0};
+  std::atomic<uint32_t> m_num_hits{0};
+};
+
+}  // namespace og3
@@ -0,0 +1,129 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+#ifndef NATIVE
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+#include "spsc_ring.h"
+
+#ifdef NATIVE
+unsigned long millis();
+#endif
+
+namespace og3 {
+
+// One measurement of the enclosure and room sensors.
+struct SensorSample {
+  uint32_t msec = 0;  // millis() at the start of the measurement
+  float enclosure_temp = 0.0f;
+  float enclosure_humidity = 0.0f;
+  float room_temp = 0.0f;
+  float room_humidity = 0.0f;
+  bool enclosure_ok = false;
+  bool room_ok = false;
+};
+
+// Reads the temperature/humidity sensors at a fixed rate, off the main loop.
+//
+// On the device a FreeRTOS task, pinned to the core the main loop is not on, calls the read
+//  functions every period_msec (retrying failed reads) and pushes each sample into a
+//  lock-free ring.  The main loop takes the newest sample with poll(), which never blocks, so
+//  a slow or flaky I2C bus no longer stalls the web server and MQTT.
+// On the host (NATIVE) there is no task, and poll() reads the sensors itself.
+class SensorTask {
+ public:
+  using ReadFn = std::function<bool(float* temperature, float* humidity)>;
+
+  struct Options {
+    unsigned long period_msec;
+    unsigned retries;  // extra attempts after a failed read
+  };
+
+  SensorTask(const Options& options, const ReadFn& read_enclosure, const ReadFn& read_room)
+      : m_options(options), m_read_enclosure(read_enclosure), m_read_room(read_room) {}
+
+  // Start sampling.  Call from the main loop's task, once the I2C buses are set up.
+  bool begin() {
+#ifndef NATIVE
+    const BaseType_t core = xPortGetCoreID() == 0 ? 1 : 0;
+    return pdPASS == xTaskCreatePinnedToCore(sampleTask, "sensors", kTaskStack, this,
+                                             tskIDLE_PRIORITY + 2, &m_task, core);
+#else
+    return true;
+#endif
+  }
+
+  // Take the newest sample, if there is one since the last call.  Never blocks on the device.
+  bool poll(SensorSample* out) {
+#ifndef NATIVE
+    return m_ring.popLatest(out);
+#else
+    *out = sample();
+    return true;
+#endif
+  }
+
+  uint32_t numSamples() const { return m_num_samples.load(); }
+  // Samples lost because the main loop did not take them in time.
+  uint32_t numDropped() const { return m_num_dropped.load(); }
+  // Failed reads, including those which succeeded on a retry.
+  uint32_t numReadErrors() const { return m_num_read_errors.load(); }
+#ifndef NATIVE
+  TaskHandle_t task() const { return m_task; }
+#endif
+
+ private:
+  static constexpr uint32_t kTaskStack = 3072;
+
+  SensorSample sample() {
+    SensorSample out;
+    out.msec = millis();
+    out.enclosure_ok = read(m_read_enclosure, &out.enclosure_temp, &out.enclosure_humidity);
+    out.room_ok = read(m_read_room, &out.room_temp, &out.room_humidity);
+    m_num_samples.fetch_add(1);
+    return out;
+  }
+
+  bool read(const ReadFn& fn, float* temperature, float* humidity) {
+    for (unsigned attempt = 0; attempt <= m_options.retries; attempt++) {
+      if (fn(temperature, humidity)) {
+        return true;
+      }
+      m_num_read_errors.fetch_add(1);
+    }
+    return false;
+  }
+
+#ifndef NATIVE
+  static void sampleTask(void* arg) {
+    auto* self = static_cast<SensorTask*>(arg);
+    TickType_t last_wake = xTaskGetTickCount();
+    while (true) {
+      if (!self->m_ring.push(self->sample())) {
+        self->m_num_dropped.fetch_add(1);
+      }
+      vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(self->m_options.period_msec));
+    }
+  }
+  SpscRing<SensorSample, 4> m_ring;
+  TaskHandle_t m_task = nullptr;
+#endif
+
+  const Options m_options;
+  const ReadFn m_read_enclosure;
+  const ReadFn m_read_room;
+  std::atomic<uint32_t> m_num_samples{0};
+  std::atomic<uint32_t> m_num_dropped{0};
+  std::atomic<uint32_t> m_num_read_errors{0};
+};
+
+}  // namespace og3
@@ -0,0 +1,76 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+namespace og3 {
+namespace shtc3 {
+
+// A minimal SHTC3 driver for use from a FreeRTOS task.
+//
+// The og3 Shtc3 module stores each reading in its variables, which belong to the main loop.
+//  These functions only talk to the sensor and return the values, so the acquisition task
+//  can measure without touching state shared with the loop.  The Arduino TwoWire object
+//  locks the bus for each transaction, so the OLED can share Wire with the sensor.
+constexpr uint8_t kAddress = 0x70;
+constexpr uint16_t kCmdWakeup = 0x3517;
+constexpr uint16_t kCmdSleep = 0xB098;
+constexpr uint16_t kCmdMeasureTFirst = 0x7866;  // normal mode, no clock stretching
+constexpr unsigned kWakeupUsec = 240;
+constexpr unsigned kMeasureMsec = 13;  // 12.1 msec maximum
+
+inline bool command(TwoWire* bus, uint16_t cmd) {
+  bus->beginTransmission(kAddress);
+  bus->write(static_cast<uint8_t>(cmd >> 8));
+  bus->write(static_cast<uint8_t>(cmd & 0xff));
+  return 0 == bus->endTransmission();
+}
+
+// CRC-8, polynomial 0x31, initial value 0xff.
+inline uint8_t crc8(const uint8_t* data, size_t len) {
+  uint8_t crc = 0xff;
+  for (size_t idx = 0; idx < len; idx++) {
+    crc ^= data[idx];
+    for (unsigned bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+// Wake the sensor, take one measurement and put it back to sleep.
+// Blocks the calling task for about 13 msec.
+inline bool measure(TwoWire* bus, float* temperature, float* humidity) {
+  if (!command(bus, kCmdWakeup)) {
+    return false;
+  }
+  delayMicroseconds(kWakeupUsec);
+  if (!command(bus, kCmdMeasureTFirst)) {
+    return false;
+  }
+  vTaskDelay(pdMS_TO_TICKS(kMeasureMsec));
+  uint8_t data[6];
+  if (sizeof(data) != bus->requestFrom(kAddress, sizeof(data))) {
+    return false;
+  }
+  for (size_t idx = 0; idx < sizeof(data); idx++) {
+    data[idx] = bus->read();
+  }
+  command(bus, kCmdSleep);
+  if (crc8(data, 2) != data[2] || crc8(data + 3, 2) != data[5]) {
+    return false;
+  }
+  const uint16_t raw_temp = (data[0] << 8) | data[1];
+  const uint16_t raw_humidity = (data[3] << 8) | data[4];
+  *temperature = -45.0f + 175.0f * raw_temp / 65536.0f;
+  *humidity = 100.0f * raw_humidity / 65536.0f;
+  return true;
+}
+
+}  // namespace shtc3
+}  // namespace og3
@@ -0,0 +1,69 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "control_history.h"
+#include "sensor_task.h"
+#include "trace_log.h"
+
+// Hooks between the firmware (main.cpp built with -D NATIVE) and the simulation driver.
+
+void setup();
+void loop();
+
+namespace og3::sim {
+
+// A snapshot of controller and actuator state, taken after each loop() iteration.
+struct Probe {
+  int state = 0;
+  const char* state_name = "";
+  bool control_enabled = false;
+  float set_temp = 0.0f;
+  float target = 0.0f;
+  float filt_temp = 0.0f;
+  float filt_d_temp = 0.0f;
+  float heater_duty = 0.0f;
+  bool heater_enabled = false;
+  bool fan = false;
+  float cmd_p = 0.0f;
+  float cmd_i = 0.0f;
+  float cmd_d = 0.0f;
+  float cmd_ff = 0.0f;
+};
+
+// Implemented in main.cpp.
+void setControlEnabled(bool enable);
+void setTargetTemp(float temp);
+// Run a relay autotune experiment instead of normal control.
+void startAutotune();
+// Load a fermentation program (JSON, as for PUT /api/program) and start it.  Returns nullptr,
+//  or a description of the problem.
+const char* startProgram(const char* json);
+Probe probe();
+// Print per-stage timing of TempControl::update().
+void printControlTiming(FILE* out);
+// Compare the cost and lag of KernelFilter and RecursiveFilter.
+void printFilterBenchmark(FILE* out);
+// Print the thermal model's feedforward estimates.
+void printThermalModel(FILE* out);
+// Print the result of the autotune experiment.
+void printAutotune(FILE* out);
+
+// Trace replay (--replay): the controller takes its sensor samples, commands, config and
+//  program from a trace recorded with traceInputs set, in place of the plant and loop().
+// Call beginReplay() before setup().
+void beginReplay();
+// Run a control tick with the traced sample; periods 0 is the update from setup().
+void replayInput(unsigned long deadline_msec, uint32_t periods, const SensorSample& sample);
+// These return false for a record they do not understand.
+bool replayCommand(uint8_t id, const TraceCommand& command);
+bool replayDocument(uint8_t kind, const char* text, size_t len);
+// The controller's values as a kTick trace record would hold them, to compare with the device.
+HistorySample replayHistorySample(unsigned long now_msec);
+
+}  // namespace og3::sim
@@ -0,0 +1,111 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+// Stand-ins for the Dough133 peripherals in the native (host) build.
+// These have the same interfaces as the og3 classes used by main.cpp, but are backed by
+//  the ThermalPlant model and the virtual clock instead of real hardware.
+
+#include <og3/tasks.h>
+#include <og3/units.h>
+#include <og3/variable.h>
+
+#include <functional>
+
+#include "sim/thermal_plant.h"
+
+unsigned long millis();
+unsigned long micros();
+
+namespace og3 {
+
+class ModuleSystem;
+
+// Placeholder for the Arduino i2c bus objects.  The Shtc3 stand-in uses the bus to decide
+//  which sensor it is: Wire is the enclosure sensor and Wire1 is the room sensor.
+class TwoWire {
+ public:
+  void setPins(int /*sda*/, int /*scl*/) {}
+};
+
+}  // namespace og3
+
+extern og3::TwoWire Wire;
+extern og3::TwoWire Wire1;
+
+namespace og3 {
+
+class Shtc3 {
+ public:
+  Shtc3(const char* temp_name, const char* humidity_name, ModuleSystem* /*module_system*/,
+        const char* description, VariableGroup& vg, bool /*publish_temp*/ = true,
+        bool /*publish_humidity*/ = true, TwoWire* bus = &Wire)
+      : m_is_room(bus == &Wire1),
+        m_temperature(temp_name, 0.0f, units::kCelsius, description, 0, 2, vg),
+        m_humidity(humidity_name, 0.0f, units::kPercentage, description, 0, 1, vg) {}
+
+  bool read() {
+    sim::ThermalPlant& plant = sim::plant();
+    if (m_is_room) {
+      if (!plant.roomSensorOk()) {
+        return false;
+      }
+      m_temperature = plant.readRoomTemp();
+      m_humidity = plant.readRoomHumidity();
+    } else {
+      m_temperature = plant.readEnclosureTemp();
+      m_humidity = plant.readEnclosureHumidity();
+    }
+    return true;
+  }
+
+  float temperature() const { return m_temperature.value(); }
+  float humidity() const { return m_humidity.value(); }
+  FloatVariable& temperatureVar() { return m_temperature; }
+  FloatVariable& humidityVar() { return m_humidity; }
+
+ private:
+  const bool m_is_room;
+  FloatVariable m_temperature;
+  FloatVariable m_humidity;
+};
+
+class Pwm {
+ public:
+  Pwm(const char* name, uint8_t pin, uint8_t channel, uint8_t resolution,
+      ModuleSystem* /*module_system*/, double frequency)
+      : m_name(name), m_pin(pin) {}
+
+  void setDutyF(float duty) { m_duty = duty; }
+  float dutyF() const { return m_duty; }
+  const char* name() const { return m_name; }
+  uint8_t pin() const { return m_pin; }
+
+ private:
+  const char* m_name;
+  const uint8_t m_pin;
+  float m_duty = 0.0f;
+};
+
+class Relay {
+ public:
+  Relay(const char* name, Tasks* tasks, uint8_t pin, const char* description, bool on_high,
+        VariableGroup& vg)
+      : m_tasks(tasks), m_is_high(name, false, description, 0, vg) {}
+
+  void turnOn() { m_is_high = true; }
+  void turnOn(unsigned msec) {
+    turnOn();
+    m_tasks->runIn(msec, [this]() { turnOff(); });
+  }
+  void turnOff() { m_is_high = false; }
+  bool isHigh() const { return m_is_high.value(); }
+  const BoolVariable& isHighVar() const { return m_is_high; }
+
+ private:
+  Tasks* m_tasks;
+  BoolVariable m_is_high;
+};
+
+}  // namespace og3
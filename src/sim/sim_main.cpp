@@ -0,0 +1,506 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+// Simulation driver for the native build.
+//
+// This runs the firmware's setup() and loop() against the ThermalPlant model, with a virtual
+//  clock in place of millis(), so a many-hour proof runs in seconds on the host.
+//
+//   pio run -e native && .pio/build/native/program --hours 12 --set-temp 27 --csv out.csv
+//
+// With --replay, it instead runs a trace recorded on a device with traceInputs set back
+//  through the controller, and compares the result with the control values the device traced.
+//
+//   .pio/build/native/program --replay trace1.bin --replay trace0.bin --csv replay.csv
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "control_timing.h"
+#include "sim/sim.h"
+#include "sim/sim_hardware.h"
+#include "sim/thermal_plant.h"
+
+og3::TwoWire Wire;
+og3::TwoWire Wire1;
+
+namespace og3::sim {
+namespace {
+
+struct Options {
+  float hours = 12.0f;
+  float set_temp = 27.0f;
+  unsigned step_msec = 50;
+  float csv_period_sec = 10.0f;
+  const char* csv_path = nullptr;
+  const char* program_path = nullptr;
+  std::vector<const char*> replay_paths;  // oldest first
+  bool bench = false;
+  bool autotune = false;
+  bool filter_bench = false;
+  ThermalPlant::Options plant;
+};
+
+VirtualClock s_clock;
+ThermalPlant* s_plant = nullptr;
+
+void usage(const char* prog) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  --hours H            simulated duration (default 12)\n"
+          "  --set-temp C         controller target temperature (default 27)\n"
+          "  --room C             room temperature at start (default 20)\n"
+          "  --room-drift C/h     room temperature change per hour (default 0)\n"
+          "  --start-temp C       enclosure temperature at start (default room)\n"
+          "  --no-room-sensor     simulate a failed room sensor\n"
+          "  --noise C            sensor noise standard deviation (default 0.01)\n"
+          "  --seed N             random seed for sensor noise (default 133)\n"
+          "  --step-msec N        simulation step (default 50)\n"
+          "  --csv PATH           write a time series to PATH\n"
+          "  --csv-period SEC     time series sample period (default 10)\n"
+          "  --program PATH       run the fermentation program in PATH (JSON, as for\n"
+          "                       PUT /api/program) instead of holding --set-temp\n"
+          "  --replay PATH        replay a trace file (repeat for several, oldest first)\n"
+          "                       recorded with traceInputs set; --csv then writes every\n"
+          "                       tick, and the plant options are not used\n"
+          "  --bench              report per-stage timing of the control update\n"
+          "  --autotune           run a relay autotune experiment and print the gains\n"
+          "  --filter-bench       compare the cost and lag of the temperature filters\n",
+          prog);
+}
+
+bool parseArgs(int argc, char** argv, Options* opts) {
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    const char* val = i + 1 < argc ? argv[i + 1] : nullptr;
+    auto need = [&]() -> const char* {
+      if (!val) {
+        fprintf(stderr, "%s needs a value\n", arg);
+        return nullptr;
+      }
+      i += 1;
+      return val;
+    };
+    if (0 == strcmp(arg, "--no-room-sensor")) {
+      opts->plant.room_sensor_ok = false;
+      continue;
+    }
+    if (0 == strcmp(arg, "--bench")) {
+      opts->bench = true;
+      continue;
+    }
+    if (0 == strcmp(arg, "--autotune")) {
+      opts->autotune = true;
+      continue;
+    }
+    if (0 == strcmp(arg, "--filter-bench")) {
+      opts->filter_bench = true;
+      continue;
+    }
+    if (0 == strcmp(arg, "--help") || 0 == strcmp(arg, "-h")) {
+      return false;
+    }
+    const char* v = need();
+    if (!v) {
+      return false;
+    }
+    if (0 == strcmp(arg, "--hours")) {
+      opts->hours = strtof(v, nullptr);
+    } else if (0 == strcmp(arg, "--set-temp")) {
+      opts->set_temp = strtof(v, nullptr);
+    } else if (0 == strcmp(arg, "--room")) {
+      opts->plant.room_temp = strtof(v, nullptr);
+    } else if (0 == strcmp(arg, "--room-drift")) {
+      opts->plant.room_drift_per_hour = strtof(v, nullptr);
+    } else if (0 == strcmp(arg, "--start-temp")) {
+      opts->plant.start_temp = strtof(v, nullptr);
+    } else if (0 == strcmp(arg, "--noise")) {
+      opts->plant.sensor_noise = strtof(v, nullptr);
+    } else if (0 == strcmp(arg, "--seed")) {
+      opts->plant.seed = static_cast<unsigned>(strtoul(v, nullptr, 10));
+    } else if (0 == strcmp(arg, "--step-msec")) {
+      opts->step_msec = static_cast<unsigned>(strtoul(v, nullptr, 10));
+    } else if (0 == strcmp(arg, "--csv")) {
+      opts->csv_path = v;
+    } else if (0 == strcmp(arg, "--csv-period")) {
+      opts->csv_period_sec = strtof(v, nullptr);
+    } else if (0 == strcmp(arg, "--program")) {
+      opts->program_path = v;
+    } else if (0 == strcmp(arg, "--replay")) {
+      opts->replay_paths.push_back(v);
+    } else {
+      fprintf(stderr, "unknown option '%s'\n", arg);
+      return false;
+    }
+  }
+  return opts->step_msec > 0 && opts->hours > 0.0f;
+}
+
+// Summary of how well the controller tracked its setpoint.
+struct Metrics {
+  float reach_sec = -1.0f;   // First time within kBand of the set temperature.
+  float settle_sec = -1.0f;  // Time from which the temperature stayed within kBand.
+  float max_overshoot = 0.0f;
+  double sq_error_sum = 0.0;  // After reaching the set temperature.
+  unsigned long sq_error_count = 0;
+  double heater_duty_sec = 0.0;  // Heater duty integrated over time.
+
+  static constexpr float kBand = 0.5f;
+
+  void add(float t_sec, float temp, float set_temp) {
+    const float error = temp - set_temp;
+    const bool in_band = std::abs(error) < kBand;
+    if (!in_band) {
+      settle_sec = -1.0f;
+    } else if (settle_sec < 0.0f) {
+      settle_sec = t_sec;
+    }
+    if (reach_sec < 0.0f) {
+      if (in_band) {
+        reach_sec = t_sec;
+      }
+      return;
+    }
+    max_overshoot = std::max(max_overshoot, error);
+    sq_error_sum += error * error;
+    sq_error_count += 1;
+  }
+  void addHeater(float duty, float dt_sec) { heater_duty_sec += duty * dt_sec; }
+  float rmsError() const {
+    return sq_error_count ? std::sqrt(sq_error_sum / sq_error_count) : std::nanf("");
+  }
+
+  void print() const {
+    if (reach_sec < 0.0f) {
+      printf("never reached +/-%.1f C of the set temperature\n", kBand);
+      return;
+    }
+    printf("reached +/-%.1f C after %.0f s\n", kBand, reach_sec);
+    if (settle_sec >= 0.0f) {
+      printf("settled within +/-%.1f C after %.0f s\n", kBand, settle_sec);
+    } else {
+      printf("not settled within +/-%.1f C at the end\n", kBand);
+    }
+    printf("max overshoot %.2f C, rms error %.3f C\n", max_overshoot, rmsError());
+  }
+};
+
+// Read a whole (small) file into *text.
+bool readFile(const char* path, std::string* text) {
+  FILE* file = fopen(path, "r");
+  if (!file) {
+    return false;
+  }
+  char buf[512];
+  while (const size_t num = fread(buf, 1, sizeof(buf), file)) {
+    text->append(buf, num);
+  }
+  fclose(file);
+  return true;
+}
+
+int run(const Options& opts) {
+  std::string program;
+  if (opts.program_path && !readFile(opts.program_path, &program)) {
+    fprintf(stderr, "failed to read '%s'\n", opts.program_path);
+    return 1;
+  }
+  ThermalPlant plant(opts.plant);
+  s_plant = &plant;
+
+  FILE* csv = nullptr;
+  if (opts.csv_path) {
+    csv = fopen(opts.csv_path, "w");
+    if (!csv) {
+      fprintf(stderr, "failed to open '%s'\n", opts.csv_path);
+      return 1;
+    }
+    fprintf(csv,
+            "sec,state,enclosure_temp,sensor_temp,room_temp,heater_temp,target,filt_temp,"
+            "filt_d_temp,heater,fan,cmd_p,cmd_i,cmd_d,cmd_ff\n");
+  }
+
+  const auto wall_start = std::chrono::steady_clock::now();
+  setup();
+  setTargetTemp(opts.set_temp);
+  if (opts.autotune) {
+    startAutotune();
+  } else if (opts.program_path) {
+    if (const char* error = startProgram(program.c_str())) {
+      fprintf(stderr, "%s: %s\n", opts.program_path, error);
+      return 1;
+    }
+  } else {
+    setControlEnabled(true);
+  }
+
+  const uint64_t end_usec = static_cast<uint64_t>(opts.hours * 3600.0 * 1e6);
+  const float step_sec = opts.step_msec * 1e-3f;
+  double next_csv_sec = 0.0;
+  Metrics metrics;
+  while (s_clock.usec() < end_usec) {
+    loop();
+    const Probe p = probe();
+    plant.step(step_sec, p.heater_duty, p.heater_enabled, p.fan);
+    s_clock.advanceMsec(opts.step_msec);
+    const double t_sec = s_clock.sec();
+    metrics.add(t_sec, plant.enclosureTemp(), p.set_temp);
+    if (csv && t_sec >= next_csv_sec) {
+      next_csv_sec += opts.csv_period_sec;
+      fprintf(csv, "%.1f,%s,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.5f,%.4f,%d,%.4f,%.4f,%.4f,%.4f\n",
+              t_sec, p.state_name, plant.enclosureTemp(), plant.sensorTemp(),
+              plant.roomTemp(), plant.heaterTemp(), p.target, p.filt_temp, p.filt_d_temp,
+              p.heater_duty, p.fan ? 1 : 0, p.cmd_p, p.cmd_i, p.cmd_d, p.cmd_ff);
+    }
+  }
+  const double wall_sec =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+  if (csv) {
+    fclose(csv);
+  }
+
+  printf("simulated %.1f h in %.2f s wall time (%.0fx)\n", opts.hours, wall_sec,
+         opts.hours * 3600.0 / wall_sec);
+  printf("final enclosure temp: %.2f C (set %.2f C, room %.2f C)\n", plant.enclosureTemp(),
+         probe().set_temp, plant.roomTemp());
+  metrics.print();
+  printf("heater energy %.1f Wh\n", plant.heaterEnergyWh());
+  printThermalModel(stdout);
+  if (opts.autotune) {
+    printAutotune(stdout);
+  }
+  if (opts.filter_bench) {
+    printFilterBenchmark(stdout);
+  }
+  if (opts.bench) {
+    printf("control update timing (host wall clock, simulated peripherals):\n");
+    printControlTiming(stdout);
+  }
+  s_plant = nullptr;
+  return 0;
+}
+
+// Append the records of a trace file to *records.
+bool readTrace(const char* path, std::vector<TraceRecord>* records) {
+  FILE* file = fopen(path, "rb");
+  if (!file) {
+    fprintf(stderr, "failed to open '%s'\n", path);
+    return false;
+  }
+  TraceFileHeader header;
+  const bool ok = 1 == fread(&header, sizeof(header), 1, file) &&
+                  0 == memcmp(header.magic, "DTRC", 4) &&
+                  header.version == TraceLog<>::kVersion &&
+                  header.record_size == sizeof(TraceRecord);
+  TraceRecord record;
+  while (ok && 1 == fread(&record, sizeof(record), 1, file)) {
+    records->push_back(record);
+  }
+  fclose(file);
+  if (!ok) {
+    fprintf(stderr, "'%s' is not a version %u trace file\n", path, TraceLog<>::kVersion);
+  }
+  return ok;
+}
+
+// Replay the first boot in the trace files which traced its inputs.
+// Each kInput record runs a control tick with the traced sample, at the traced time; commands,
+//  config and program records are applied in order between ticks.  The controller's values
+//  are compared with each kTick record the device wrote, which holds them in fixed point.
+int replay(const Options& opts) {
+  std::vector<TraceRecord> records;
+  for (const char* path : opts.replay_paths) {
+    if (!readTrace(path, &records)) {
+      return 1;
+    }
+  }
+  size_t begin = records.size();
+  for (size_t idx = 0; idx < records.size(); idx++) {
+    if (records[idx].type == TraceRecord::kBoot) {
+      begin = idx;
+    } else if (records[idx].type == TraceRecord::kInput && begin < records.size()) {
+      break;
+    }
+  }
+  if (begin == records.size()) {
+    fprintf(stderr, "no boot with traced inputs (set traceInputs and restart the device)\n");
+    return 1;
+  }
+
+  FILE* csv = nullptr;
+  if (opts.csv_path) {
+    csv = fopen(opts.csv_path, "w");
+    if (!csv) {
+      fprintf(stderr, "failed to open '%s'\n", opts.csv_path);
+      return 1;
+    }
+    fprintf(csv,
+            "msec,state,enclosure_temp,room_temp,set_temp,target,filt_temp,filt_d_temp,heater,"
+            "fan,cmd_p,cmd_i,cmd_d,cmd_ff\n");
+  }
+
+  const auto wall_start = std::chrono::steady_clock::now();
+  const unsigned long boot_msec = records[begin].msec;
+  s_clock.advanceMsec(boot_msec);
+  beginReplay();
+  setup();
+
+  Metrics metrics;
+  unsigned num_inputs = 0;
+  unsigned num_commands = 0;
+  unsigned num_documents = 0;
+  unsigned num_unknown = 0;
+  unsigned num_missing = 0;
+  unsigned num_compared = 0;
+  unsigned num_mismatched = 0;
+  unsigned num_transitions = 0;
+  unsigned long first_mismatch_msec = 0;
+  HistorySample first_mismatch_device = {};
+  HistorySample first_mismatch_replay = {};
+  double state_sec[8] = {};
+  const char* state_names[8] = {};
+  unsigned long last_input_msec = boot_msec;
+  uint16_t seq = records[begin].seq;
+  std::string document;
+  size_t idx = begin + 1;
+  for (; idx < records.size() && records[idx].type != TraceRecord::kBoot; idx++) {
+    const TraceRecord& record = records[idx];
+    num_missing += static_cast<uint16_t>(record.seq - seq - 1);
+    seq = record.seq;
+    if (record.msec > s_clock.msec()) {
+      s_clock.advanceMsec(record.msec - s_clock.msec());
+    }
+    switch (record.type) {
+      case TraceRecord::kInput: {
+        const TraceInput& input = record.input;
+        SensorSample sample;
+        sample.msec = input.sample_msec;
+        sample.enclosure_temp = input.enclosure_temp;
+        sample.enclosure_humidity = input.enclosure_humidity;
+        sample.room_temp = input.room_temp;
+        sample.room_humidity = input.room_humidity;
+        sample.enclosure_ok = input.flags & TraceInput::kEnclosureOk;
+        sample.room_ok = input.flags & TraceInput::kRoomOk;
+        const Probe before = probe();
+        replayInput(record.msec - input.late_msec, input.periods, sample);
+        const Probe p = probe();
+        const float dt_sec = (record.msec - last_input_msec) * 1e-3f;
+        last_input_msec = record.msec;
+        num_inputs += 1;
+        state_sec[before.state & 7] += dt_sec;
+        state_names[before.state & 7] = before.state_name;
+        metrics.addHeater(before.heater_enabled ? before.heater_duty : 0.0f, dt_sec);
+        if (p.control_enabled) {
+          metrics.add((record.msec - boot_msec) * 1e-3f, sample.enclosure_temp, p.set_temp);
+        }
+        if (csv) {
+          fprintf(csv, "%u,%s,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%d,%.9g,%.9g,%.9g,%.9g\n",
+                  record.msec, p.state_name, sample.enclosure_temp, sample.room_temp,
+                  p.set_temp, p.target, p.filt_temp, p.filt_d_temp, p.heater_duty,
+                  p.fan ? 1 : 0, p.cmd_p, p.cmd_i, p.cmd_d, p.cmd_ff);
+        }
+        break;
+      }
+      case TraceRecord::kCommand:
+        num_commands += 1;
+        num_unknown += replayCommand(record.arg, record.command) ? 0 : 1;
+        break;
+      case TraceRecord::kDocument:
+        document.append(record.text, strnlen(record.text, sizeof(record.text)));
+        if (record.arg & kTraceDocumentLast) {
+          num_documents += 1;
+          num_unknown += replayDocument(record.arg & ~kTraceDocumentLast, document.data(),
+                                        document.size())
+                             ? 0
+                             : 1;
+          document.clear();
+        }
+        break;
+      case TraceRecord::kTick: {
+        const HistorySample replayed = replayHistorySample(record.msec);
+        num_compared += 1;
+        if (0 != memcmp(&replayed, &record.sample, sizeof(replayed))) {
+          if (num_mismatched == 0) {
+            first_mismatch_msec = record.msec;
+            first_mismatch_device = record.sample;
+            first_mismatch_replay = replayed;
+          }
+          num_mismatched += 1;
+        }
+        break;
+      }
+      case TraceRecord::kTransition:
+        num_transitions += 1;
+        break;
+      default:
+        num_unknown += 1;
+        break;
+    }
+  }
+  const double wall_sec =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+  if (csv) {
+    fclose(csv);
+  }
+
+  const double hours = (s_clock.msec() - boot_msec) / 3.6e6;
+  printf("replayed %u ticks (%.2f h) in %.2f s wall time\n", num_inputs, hours, wall_sec);
+  printf("commands %u, documents %u, not understood %u, missing records %u%s\n", num_commands,
+         num_documents, num_unknown, num_missing,
+         idx < records.size() ? " (stopped at the next boot)" : "");
+  printf("device transitions %u\n", num_transitions);
+  printf("device ticks compared %u, mismatched %u\n", num_compared, num_mismatched);
+  if (num_mismatched > 0) {
+    const HistorySample& d = first_mismatch_device;
+    const HistorySample& r = first_mismatch_replay;
+    printf("first mismatch at %lu msec: device state %u target %.2f heater %.4f p %.4f i %.4f, "
+           "replay state %u target %.2f heater %.4f p %.4f i %.4f\n",
+           first_mismatch_msec, d.state, d.target_c100 / 100.0, d.heater_x1e4 / 1e4,
+           d.p_x1e4 / 1e4, d.i_x1e4 / 1e4, r.state, r.target_c100 / 100.0, r.heater_x1e4 / 1e4,
+           r.p_x1e4 / 1e4, r.i_x1e4 / 1e4);
+  }
+  metrics.print();
+  printf("heater duty %.3f h\n", metrics.heater_duty_sec / 3600.0);
+  for (unsigned state = 0; state < 8; state++) {
+    if (state_sec[state] > 0.0) {
+      printf("time in %s: %.0f s\n", state_names[state], state_sec[state]);
+    }
+  }
+  printThermalModel(stdout);
+  if (opts.bench) {
+    printf("control update timing (host wall clock, simulated peripherals):\n");
+    printControlTiming(stdout);
+  }
+  return num_unknown > 0 ? 1 : 0;
+}
+
+}  // namespace
+
+VirtualClock& clock() { return s_clock; }
+ThermalPlant& plant() { return *s_plant; }
+
+}  // namespace og3::sim
+
+unsigned long millis() { return og3::sim::clock().msec(); }
+unsigned long micros() { return static_cast<unsigned long>(og3::sim::clock().usec()); }
+
+uint32_t og3::timingUsec() {
+  static const auto s_start = std::chrono::steady_clock::now();
+  return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                   std::chrono::steady_clock::now() - s_start)
+                                   .count());
+}
+
+int main(int argc, char** argv) {
+  og3::sim::Options opts;
+  if (!og3::sim::parseArgs(argc, argv, &opts)) {
+    og3::sim::usage(argv[0]);
+    return 2;
+  }
+  return opts.replay_paths.empty() ? og3::sim::run(opts) : og3::sim::replay(opts);
+}
@@ -0,0 +1,124 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+// Host-side model of the Dough133 hardware, used by the native build.
+namespace og3::sim {
+
+// A clock which only advances when the simulation steps it.
+// millis() and micros() in the native build read from this clock.
+class VirtualClock {
+ public:
+  uint64_t usec() const { return m_usec; }
+  unsigned long msec() const { return static_cast<unsigned long>(m_usec / 1000); }
+  double sec() const { return m_usec * 1e-6; }
+  void advanceUsec(uint64_t usec) { m_usec += usec; }
+  void advanceMsec(unsigned msec) { m_usec += static_cast<uint64_t>(msec) * 1000; }
+
+ private:
+  uint64_t m_usec = 0;
+};
+
+// Lumped-capacitance model of a cooler with a PTC heater and fan inside.
+//
+// There are three thermal nodes:
+//  - the heater element, which receives the electrical power,
+//  - the enclosure (air, walls and dough lumped together), heated by the element and
+//     losing heat through the cooler insulation to the room,
+//  - the SHTC3 sensor, which lags the enclosure with a first-order time constant.
+// The fan increases the coupling between the heater element and the enclosure.
+class ThermalPlant {
+ public:
+  struct Options {
+    float heater_watts = 100.0f;           // Heater power at 100% duty.
+    float heater_capacity = 150.0f;        // J/°C
+    float heater_coupling_fan_on = 6.0f;   // W/°C heater->enclosure with fan.
+    float heater_coupling_fan_off = 1.0f;  // W/°C heater->enclosure without fan.
+    float enclosure_capacity = 6000.0f;    // J/°C
+    float insulation_loss = 1.0f;          // W/°C enclosure->room.
+    float sensor_tau_sec = 20.0f;          // Sensor lag.
+    float sensor_noise = 0.01f;            // °C standard deviation.
+    float sensor_resolution = 0.01f;       // °C
+    float room_temp = 20.0f;               // °C at time zero.
+    float room_drift_per_hour = 0.0f;      // °C/hour, e.g. a kitchen cooling overnight.
+    float start_temp = std::nanf("");      // Enclosure temp at time zero (default room).
+    float enclosure_humidity = 60.0f;      // %
+    float room_humidity = 45.0f;           // %
+    bool room_sensor_ok = true;            // Set false to simulate a missing room sensor.
+    unsigned seed = 133;
+  };
+
+  explicit ThermalPlant(const Options& opts)
+      : m_opts(opts),
+        m_heater_temp(std::isnan(opts.start_temp) ? opts.room_temp : opts.start_temp),
+        m_enclosure_temp(m_heater_temp),
+        m_sensor_temp(m_heater_temp),
+        m_rng(opts.seed) {}
+
+  // Advance the model by dt_sec with the given actuator outputs.
+  void step(float dt_sec, float heater_duty, bool heater_enabled, bool fan_on) {
+    m_time_sec += dt_sec;
+    const float duty = heater_enabled ? std::max(0.0f, std::min(1.0f, heater_duty)) : 0.0f;
+    m_heater_power = duty * m_opts.heater_watts;
+    m_heater_energy_j += m_heater_power * dt_sec;
+    const float coupling = fan_on ? m_opts.heater_coupling_fan_on : m_opts.heater_coupling_fan_off;
+    const float q_heater = coupling * (m_heater_temp - m_enclosure_temp);
+    const float q_loss = m_opts.insulation_loss * (m_enclosure_temp - roomTemp());
+    m_heater_temp += dt_sec * (m_heater_power - q_heater) / m_opts.heater_capacity;
+    m_enclosure_temp += dt_sec * (q_heater - q_loss) / m_opts.enclosure_capacity;
+    m_sensor_temp += (m_enclosure_temp - m_sensor_temp) * (dt_sec / m_opts.sensor_tau_sec);
+  }
+
+  float roomTemp() const {
+    return m_opts.room_temp + m_opts.room_drift_per_hour * static_cast<float>(m_time_sec / 3600.0);
+  }
+  float enclosureTemp() const { return m_enclosure_temp; }
+  float heaterTemp() const { return m_heater_temp; }
+  float sensorTemp() const { return m_sensor_temp; }
+  float heaterPower() const { return m_heater_power; }
+  double heaterEnergyWh() const { return m_heater_energy_j / 3600.0; }
+
+  // What the SHTC3 sensors report: lagged, noisy and quantized.
+  float readEnclosureTemp() { return quantize(m_sensor_temp + noise()); }
+  float readRoomTemp() { return quantize(roomTemp() + noise()); }
+  float readEnclosureHumidity() { return m_opts.enclosure_humidity; }
+  float readRoomHumidity() { return m_opts.room_humidity; }
+  bool roomSensorOk() const { return m_opts.room_sensor_ok; }
+
+  const Options& options() const { return m_opts; }
+
+ private:
+  float noise() {
+    if (m_opts.sensor_noise <= 0.0f) {
+      return 0.0f;
+    }
+    return std::normal_distribution<float>(0.0f, m_opts.sensor_noise)(m_rng);
+  }
+  float quantize(float val) const {
+    if (m_opts.sensor_resolution <= 0.0f) {
+      return val;
+    }
+    return std::round(val / m_opts.sensor_resolution) * m_opts.sensor_resolution;
+  }
+
+  const Options m_opts;
+  double m_time_sec = 0.0;
+  float m_heater_temp;
+  float m_enclosure_temp;
+  float m_sensor_temp;
+  float m_heater_power = 0.0f;
+  double m_heater_energy_j = 0.0;
+  std::mt19937 m_rng;
+};
+
+// The clock and plant shared by the stand-in hardware and the simulation driver.
+VirtualClock& clock();
+ThermalPlant& plant();
+
+}  // namespace og3::sim
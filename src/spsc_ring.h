@@ -0,0 +1,63 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace og3 {
+
+// A lock-free ring buffer for passing values from one producer task to one consumer task.
+//
+// The producer only writes m_head and the consumer only writes m_tail, so neither side ever
+//  waits for the other: push() fails when the ring is full and pop() when it is empty.
+// The indices count up forever and are reduced modulo N, so N must be a power of two.
+template <typename T, size_t N>
+class SpscRing {
+ public:
+  static_assert(N > 0 && (N & (N - 1)) == 0, "N must be a power of two");
+
+  // Producer: add a value.  Returns false (and drops the value) if the ring is full.
+  bool push(const T& value) {
+    const uint32_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail.load(std::memory_order_acquire) >= N) {
+      return false;
+    }
+    m_items[head % N] = value;
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer: take the oldest value.  Returns false if the ring is empty.
+  bool pop(T* out) {
+    const uint32_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    *out = m_items[tail % N];
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer: take the newest value, discarding older ones.  Returns false if empty.
+  bool popLatest(T* out) {
+    bool got = false;
+    while (pop(out)) {
+      got = true;
+    }
+    return got;
+  }
+
+  size_t size() const {
+    return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+  }
+
+ private:
+  std::atomic<uint32_t> m_head{0};  // next slot to write
+  std::atomic<uint32_t> m_tail{0};  // next slot to read
+  T m_items[N];
+};
+
+}  // namespace og3
@@ -0,0 +1,111 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+#ifndef NATIVE
+#include <PsychicHttp.h>
+#endif
+
+namespace og3 {
+
+// A web interface file embedded in flash, precompressed at build time by
+//  svelte/embed-assets.mjs (see the generated web_assets.h).
+struct StaticAsset {
+  const char* path;  // URL path
+  const char* content_type;
+  const uint8_t* gzip;
+  size_t gzip_size;
+  const uint8_t* brotli;  // nullptr when brotli is no smaller than gzip
+  size_t brotli_size;
+  const char* etag;  // quoted hash of the uncompressed content
+  bool immutable;    // the name carries the content hash, so it never changes
+};
+
+// Returns true if an Accept-Encoding header value allows the given coding.  Preferences
+//  between codings are ignored, but "q=0" refuses a coding.
+inline bool acceptsEncoding(const char* accept, const char* coding) {
+  const size_t len = strlen(coding);
+  const char* pos = accept;
+  while (*pos) {
+    while (*pos == ' ' || *pos == ',') {
+      pos++;
+    }
+    const char* token = pos;
+    while (*pos && *pos != ',' && *pos != ';' && *pos != ' ') {
+      pos++;
+    }
+    const size_t token_len = pos - token;
+    const bool match = (token_len == len && 0 == strncasecmp(token, coding, len)) ||
+                       (token_len == 1 && *token == '*');
+    bool refused = false;
+    while (*pos && *pos != ',') {
+      if (*pos == ';') {
+        pos++;
+        while (*pos == ' ') {
+          pos++;
+        }
+        if ((*pos == 'q' || *pos == 'Q') && pos[1] == '=') {
+          refused = strtod(pos + 2, nullptr) == 0.0;
+        }
+      } else {
+        pos++;
+      }
+    }
+    if (match && !refused) {
+      return true;
+    }
+  }
+  return false;
+}
+
+#ifndef NATIVE
+// Serve an asset.  Content-hashed files are cached by the browser for a year without
+//  revalidation; the others (index.html, which names the hashed files) are revalidated with
+//  their ETag, which costs a 304 and no body.  Brotli is sent when the client accepts it,
+//  gzip otherwise: an identity copy is not kept, as it would double the flash used.
+inline esp_err_t sendStaticAsset(PsychicRequest* request, PsychicResponse* response,
+                                 const StaticAsset& asset) {
+  response->addHeader("Cache-Control",
+                      asset.immutable ? "public, max-age=31536000, immutable" : "no-cache");
+  response->addHeader("ETag", asset.etag);
+  if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == asset.etag) {
+    response->setCode(304);
+    return response->send();
+  }
+  const bool brotli =
+      asset.brotli && acceptsEncoding(request->header("Accept-Encoding").c_str(), "br");
+  response->setCode(200);
+  response->setContentType(asset.content_type);
+  response->addHeader("Content-Encoding", brotli ? "br" : "gzip");
+  response->addHeader("Vary", "Accept-Encoding");
+  if (brotli) {
+    response->setContent(asset.brotli, asset.brotli_size);
+  } else {
+    response->setContent(asset.gzip, asset.gzip_size);
+  }
+  return response->send();
+}
+
+// Register a GET route for each asset, and serve index.html (if present) at "/" too.
+inline void registerStaticAssets(PsychicHttpServer* server, const StaticAsset* assets,
+                                 size_t num_assets) {
+  for (size_t idx = 0; idx < num_assets; idx++) {
+    const StaticAsset* asset = &assets[idx];
+    auto handler = [asset](PsychicRequest* request, PsychicResponse* response) {
+      return sendStaticAsset(request, response, *asset);
+    };
+    server->on(asset->path, HTTP_GET, handler);
+    if (0 == strcmp(asset->path, "/index.html")) {
+      server->on("/", HTTP_GET, handler);
+    }
+  }
+}
+#endif
+
+}  // namespace og3
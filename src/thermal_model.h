@@ -0,0 +1,166 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+namespace og3 {
+
+// Recursive least squares for y = theta . x, with exponential forgetting.
+// Old data is weighted by forgetting^age, so the estimate tracks slow changes in the plant.
+// The diagonal of the covariance is capped so that it cannot wind up while there is little
+//  excitation (e.g. holding a steady temperature for hours).
+template <unsigned N>
+class Rls {
+ public:
+  void reset(float initial_variance) {
+    for (unsigned i = 0; i < N; i++) {
+      m_theta[i] = 0.0f;
+      for (unsigned j = 0; j < N; j++) {
+        m_p[i][j] = i == j ? initial_variance : 0.0f;
+      }
+    }
+    m_max_variance = initial_variance;
+    m_residual_var = 0.0f;
+    m_num_updates = 0;
+  }
+
+  // Returns the a-priori prediction error.
+  float update(const float (&x)[N], float y, float forgetting) {
+    float px[N];
+    float xpx = 0.0f;
+    float prediction = 0.0f;
+    for (unsigned i = 0; i < N; i++) {
+      px[i] = 0.0f;
+      for (unsigned j = 0; j < N; j++) {
+        px[i] += m_p[i][j] * x[j];
+      }
+      xpx += x[i] * px[i];
+      prediction += m_theta[i] * x[i];
+    }
+    const float error = y - prediction;
+    const float denom = forgetting + xpx;
+    for (unsigned i = 0; i < N; i++) {
+      m_theta[i] += px[i] / denom * error;
+    }
+    for (unsigned i = 0; i < N; i++) {
+      for (unsigned j = i; j < N; j++) {
+        const float pij = (m_p[i][j] - px[i] * px[j] / denom) / forgetting;
+        m_p[i][j] = m_p[j][i] = pij;
+      }
+      m_p[i][i] = std::min(m_p[i][i], m_max_variance);
+    }
+    // The a-posteriori error, which does not include the error of the initial estimate.
+    const float residual = error * forgetting / denom;
+    if (m_num_updates == 0) {
+      m_residual_var = residual * residual;
+    } else {
+      m_residual_var = forgetting * m_residual_var + (1.0f - forgetting) * residual * residual;
+    }
+    m_num_updates += 1;
+    return error;
+  }
+
+  float theta(unsigned i) const { return m_theta[i]; }
+  // Standard deviation of theta[i], from the covariance and the residual variance.
+  float stddev(unsigned i) const {
+    return std::sqrt(std::max(0.0f, m_p[i][i] * m_residual_var));
+  }
+  float rmsResidual() const { return std::sqrt(m_residual_var); }
+  unsigned numUpdates() const { return m_num_updates; }
+
+ private:
+  float m_theta[N] = {};
+  float m_p[N][N] = {};
+  float m_max_variance = 0.0f;
+  float m_residual_var = 0.0f;
+  unsigned m_num_updates = 0;
+};
+
+// Online identification of the two feedforward coefficients from heater duty and enclosure
+//  temperature.
+//
+// The enclosure is modelled as C dT/dt = P u - L (T - T_ref): heater duty u, heater power P,
+//  heat capacity C, insulation loss L and reference (room) temperature T_ref.  Solving for u,
+//  u = (C/P) dT/dt + (L/P) (T - T_ref), so the coefficients are the dynamic feedforward
+//  (pwm per °C/s) and the static feedforward (pwm per °C above the reference).
+// Samples are averaged over period_msec windows, which smooths over sensor noise and the
+//  heater's own lag, and each window is one RLS update.
+class ThermalModel {
+ public:
+  struct Options {
+    unsigned long period_msec;
+    unsigned min_updates;  // before an estimate is trusted
+    float max_rel_stddev;  // an estimate is trusted if stddev < max_rel_stddev * |estimate|
+  };
+
+  explicit ThermalModel(const Options& options) : m_options(options) { reset(); }
+
+  void reset() {
+    m_rls.reset(kInitialVariance);
+    m_window_count = 0;
+  }
+
+  // Add a control tick's temperature, reference temperature and heater duty.
+  // Call only while the heater is under control.  A gap of more than two periods restarts the
+  //  current window, so time with the heater off is not mistaken for a response.
+  void add(unsigned long now_msec, float temp, float ref_temp, float duty, float forgetting) {
+    if (std::isnan(temp) || std::isnan(ref_temp) || std::isnan(duty)) {
+      return;
+    }
+    if (m_window_count > 0 && now_msec - m_last_msec > 2 * m_options.period_msec) {
+      m_window_count = 0;
+    }
+    m_last_msec = now_msec;
+    if (m_window_count == 0) {
+      m_window_start_msec = now_msec;
+      m_window_start_temp = temp;
+      m_sum_duty = 0.0f;
+      m_sum_delta_temp = 0.0f;
+    }
+    m_sum_duty += duty;
+    m_sum_delta_temp += temp - ref_temp;
+    m_window_count += 1;
+    const unsigned long window_msec = now_msec - m_window_start_msec;
+    if (window_msec < m_options.period_msec) {
+      return;
+    }
+    const float d_temp = (temp - m_window_start_temp) / (window_msec * 1e-3f);
+    const float x[2] = {d_temp * kRateScale, m_sum_delta_temp / m_window_count};
+    m_rls.update(x, m_sum_duty / m_window_count, forgetting);
+    m_window_count = 0;
+  }
+
+  float ffPerRate() const { return m_rls.theta(0) * kRateScale; }  // pwm / (°C/s)
+  float ffPerDeltaC() const { return m_rls.theta(1); }             // pwm / °C
+  float ffPerRateStddev() const { return m_rls.stddev(0) * kRateScale; }
+  float ffPerDeltaCStddev() const { return m_rls.stddev(1); }
+  float rmsResidual() const { return m_rls.rmsResidual(); }  // pwm
+  unsigned numUpdates() const { return m_rls.numUpdates(); }
+
+  bool ffPerRateOk() const { return ok(ffPerRate(), ffPerRateStddev()); }
+  bool ffPerDeltaCOk() const { return ok(ffPerDeltaC(), ffPerDeltaCStddev()); }
+
+ private:
+  // dT/dt is regressed in °C per 1000 s so that both coefficients are of similar size.
+  static constexpr float kRateScale = 1000.0f;
+  static constexpr float kInitialVariance = 1.0f;
+
+  bool ok(float estimate, float stddev) const {
+    return numUpdates() >= m_options.min_updates && estimate > 0.0f &&
+           stddev < m_options.max_rel_stddev * estimate;
+  }
+
+  const Options m_options;
+  Rls<2> m_rls;
+  unsigned long m_last_msec = 0;
+  unsigned long m_window_start_msec = 0;
+  float m_window_start_temp = 0.0f;
+  float m_sum_duty = 0.0f;
+  float m_sum_delta_temp = 0.0f;
+  unsigned m_window_count = 0;
+};
+
+}  // namespace og3
@@ -0,0 +1,439 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#ifndef NATIVE
+#include <LittleFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "control_history.h"
+
+namespace og3 {
+
+// The inputs of one control tick (TraceRecord::kInput): the sensor sample the control update
+//  used, and when the tick ran.  Floats are stored whole so that a replay is exact.
+struct TraceInput {
+  enum Flags : uint8_t { kEnclosureOk = 1, kRoomOk = 2 };
+  float enclosure_temp;
+  float room_temp;
+  float enclosure_humidity;
+  float room_humidity;
+  uint32_t sample_msec;  // when the sample was measured
+  uint16_t late_msec;    // how long after its deadline the tick ran
+  uint8_t periods;       // tick periods since the last tick; 0 for the update in setup()
+  uint8_t flags;
+};
+static_assert(sizeof(TraceInput) == 24, "TraceInput is part of the trace file format");
+
+// A command to the controller (TraceRecord::kCommand, with the TraceCommandId in arg).  It
+//  carries the enclosure reading the controller had when the command ran, which may be newer
+//  than the last tick's.
+struct TraceCommand {
+  float value;
+  uint32_t param;
+  uint32_t sample_msec;
+  float enclosure_temp;
+  uint8_t enclosure_ok;
+  uint8_t reserved[7];
+};
+static_assert(sizeof(TraceCommand) == 24, "TraceCommand is part of the trace file format");
+
+enum TraceCommandId : uint8_t {
+  kTraceEnable = 1,          // value: 1 to enable control, 0 to disable it
+  kTraceButton = 2,          // param: the ButtonEvents::Event
+  kTraceTestCommand = 3,     // run the test command
+  kTraceAutotune = 4,        // start autotune
+  kTraceSetTemp = 5,         // value: the new set temperature
+  kTraceFanMode = 6,         // param: 1 for high, 0 for off
+  kTraceProgramStart = 7,    // start the fermentation program
+  kTraceProgramStop = 8,     // stop it
+  kTraceProgramResume = 9,   // value: the run's start temperature, param: its elapsed sec
+  kTraceProgramSkip = 10,    // param: sec the program skips for time the device was off
+};
+
+// Kinds of JSON document (TraceRecord::kDocument), in the low bits of arg.
+enum TraceDocumentKind : uint8_t {
+  kTraceConfig = 0,   // the dough_cfg and dough_cmd config variables
+  kTraceProgram = 1,  // the fermentation program
+  kTraceDocumentLast = 0x80,  // set in arg on the last record of a document
+};
+
+// One trace record.  Trace files are a TraceFileHeader followed by packed TraceRecords,
+//  all little-endian.
+struct TraceRecord {
+  enum Type : uint8_t {
+    kBoot = 1,        // the device started; arg is the reset reason
+    kTick = 2,        // a control tick
+    kTransition = 3,  // a TempControl state change; arg is the previous state
+    kInput = 4,       // the inputs of a control tick
+    kCommand = 5,     // a command; arg is the TraceCommandId
+    kDocument = 6,    // 24 bytes of a JSON document, padded with zeros; arg is the kind
+  };
+  uint32_t msec;  // millis() when recorded
+  uint8_t type;
+  uint8_t arg;
+  uint16_t seq;  // counts records since boot, so gaps and overlaps can be found
+  union {
+    HistorySample sample;  // control values; sample.state is the state after the record
+    TraceInput input;
+    TraceCommand command;
+    char text[24];
+  };
+};
+static_assert(sizeof(TraceRecord) == 32, "TraceRecord is part of the trace file format");
+
+struct TraceFileHeader {
+  char magic[4];  // "DTRC"
+  uint16_t version;
+  uint16_t record_size;
+  uint32_t block_size;
+  uint8_t reserved[20];
+};
+static_assert(sizeof(TraceFileHeader) == sizeof(TraceRecord),
+              "The header takes the place of one record so blocks hold whole records");
+
+// A persistent log of control ticks and state transitions, kept for post-mortem analysis.
+//  It can also record the controller's inputs (see traceInputs in main.cpp) for replay.
+//
+// Records are staged in RAM and written to flash by a low-priority background task, so the
+//  control loop never waits on LittleFS.  The staging buffer mirrors the position in the file
+//  modulo kBlockSize, so a full staging block is written as one aligned block.  A partially
+//  filled block is written only after max_flush_delay_msec (bounding what a power cut can
+//  lose) or when flush() is called, and the rest of that block is written by the next flush.
+// Files are rotated when the newest reaches file_bytes, so the log never exceeds
+//  num_files * file_bytes: <dir>/trace0.bin is the newest and trace<num_files-1>.bin the oldest.
+// If the staging block fills while the previous block is still being written, records are
+//  dropped and counted rather than blocking.
+template <size_t kBlockSize = 4096>
+class TraceLog {
+ public:
+  static constexpr uint16_t kVersion = 2;
+  static_assert(kBlockSize % sizeof(TraceRecord) == 0, "Blocks must hold whole records");
+
+  struct Options {
+    const char* dir;
+    unsigned num_files;
+    size_t file_bytes;  // rounded down to a multiple of kBlockSize
+    unsigned long max_flush_delay_msec;
+  };
+
+  explicit TraceLog(const Options& options) : m_options(options) {
+    if (m_options.file_bytes < kBlockSize) {
+      m_options.file_bytes = kBlockSize;
+    }
+    m_options.file_bytes -= m_options.file_bytes % kBlockSize;
+  }
+
+  // Open the log, continuing the newest file, and record a boot.
+  // Call once the filesystem is mounted.
+  bool begin(unsigned long now_msec, uint8_t reset_reason) {
+    if (!makeDir()) {
+      return false;
+    }
+    char path[48];
+    filePath(0, path, sizeof(path));
+    const size_t size = fileSize(path);
+    if (size % sizeof(TraceRecord) != 0 || size >= m_options.file_bytes ||
+        (size > 0 && !currentFormat(path))) {
+      m_file_used = m_options.file_bytes;  // Start a new file with the first block.
+    } else {
+      m_file_used = size;
+    }
+#ifndef NATIVE
+    if (pdPASS != xTaskCreatePinnedToCore(flushTask, "trace", kFlushTaskStack, this,
+                                          tskIDLE_PRIORITY + 1, &m_task, tskNO_AFFINITY)) {
+      return false;
+    }
+#endif
+    startBlock(m_blocks[m_active], m_file_used % kBlockSize);
+    m_started = true;
+    const HistorySample sample = {};
+    add(TraceRecord::kBoot, now_msec, reset_reason, &sample);
+    return true;
+  }
+
+  void addTick(unsigned long now_msec, const HistoryInput& in) {
+    const HistorySample sample = toHistorySample(now_msec / 1000, in);
+    add(TraceRecord::kTick, now_msec, 0, &sample);
+  }
+  void addTransition(unsigned long now_msec, uint8_t from_state, const HistoryInput& in) {
+    const HistorySample sample = toHistorySample(now_msec / 1000, in);
+    add(TraceRecord::kTransition, now_msec, from_state, &sample);
+  }
+  void addInput(unsigned long now_msec, const TraceInput& input) {
+    add(TraceRecord::kInput, now_msec, 0, &input);
+  }
+  void addCommand(unsigned long now_msec, TraceCommandId id, const TraceCommand& command) {
+    add(TraceRecord::kCommand, now_msec, id, &command);
+  }
+  // Record a document as a run of kDocument records.
+  void addDocument(unsigned long now_msec, TraceDocumentKind kind, const char* text,
+                   size_t len) {
+    constexpr size_t kChunk = sizeof(TraceRecord::text);
+    for (size_t pos = 0; pos < len || pos == 0; pos += kChunk) {
+      char chunk[kChunk] = {};
+      memcpy(chunk, text + pos, std::min(kChunk, len - pos));
+      const bool last = pos + kChunk >= len;
+      add(TraceRecord::kDocument, now_msec, kind | (last ? kTraceDocumentLast : 0), chunk);
+    }
+  }
+
+  // Write out staged records which have waited too long.  Call once per control tick.
+  void poll(unsigned long now_msec) {
+    const Block& block = m_blocks[m_active];
+    if (block.fill > block.start &&
+        (m_flush_requested || now_msec - m_first_staged_msec >= m_options.max_flush_delay_msec)) {
+      submit();
+    }
+  }
+
+  // Write out staged records as soon as possible, e.g. after an error.
+  void flush() {
+    if (m_started && m_blocks[m_active].fill > m_blocks[m_active].start && !submit()) {
+      m_flush_requested = true;  // Retried by poll().
+    }
+  }
+
+  // Flush and wait (up to timeout_msec) for the write to finish, e.g. before a restart.
+  void flushAndWait(unsigned timeout_msec) {
+#ifndef NATIVE
+    for (unsigned msec = 0; m_writing.load() && msec < timeout_msec; msec += 10) {
+      vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    flush();
+    for (unsigned msec = 0; m_writing.load() && msec < timeout_msec; msec += 10) {
+      vTaskDelay(pdMS_TO_TICKS(10));
+    }
+#else
+    flush();
+#endif
+  }
+
+  const Options& options() const { return m_options; }
+  // Path of the idx'th file, 0 being the newest.
+  void filePath(unsigned idx, char* out, size_t size) const {
+    snprintf(out, size, "%s/trace%u.bin", m_options.dir, idx);
+  }
+  static size_t fileSize(const char* path) {
+#ifndef NATIVE
+    File file = LittleFS.open(path, "r");
+    if (!file) {
+      return 0;
+    }
+    const size_t size = file.size();
+    file.close();
+    return size;
+#else
+    struct stat st;
+    return 0 == stat(path, &st) ? static_cast<size_t>(st.st_size) : 0;
+#endif
+  }
+
+  // True if the file's header is of this version, so records can be appended to it.
+  static bool currentFormat(const char* path) {
+    TraceFileHeader header = {};
+#ifndef NATIVE
+    File file = LittleFS.open(path, "r");
+    if (!file) {
+      return false;
+    }
+    const bool ok =
+        sizeof(header) == file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header));
+    file.close();
+#else
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+      return false;
+    }
+    const bool ok = 1 == fread(&header, sizeof(header), 1, file);
+    fclose(file);
+#endif
+    return ok && 0 == memcmp(header.magic, "DTRC", 4) && header.version == kVersion &&
+           header.record_size == sizeof(TraceRecord) && header.block_size == kBlockSize;
+  }
+
+  uint32_t numDropped() const { return m_num_dropped; }
+  uint32_t numWrites() const { return m_num_writes; }
+  uint32_t numWriteErrors() const { return m_num_write_errors; }
+  uint32_t bytesWritten() const { return m_bytes_written; }
+#ifndef NATIVE
+  TaskHandle_t task() const { return m_task; }
+#endif
+
+ private:
+  static constexpr uint32_t kFlushTaskStack = 4096;
+
+  // A staging block.  Bytes [start, fill) are waiting to be written; data[0..start) was
+  //  written by an earlier partial flush.
+  struct Block {
+    uint8_t data[kBlockSize];
+    size_t start = 0;
+    size_t fill = 0;
+    bool new_file = false;  // rotate files before writing this block
+  };
+
+  // Stage a record, whose 24-byte payload is copied from payload.
+  void add(TraceRecord::Type type, unsigned long now_msec, uint8_t arg, const void* payload) {
+    if (!m_started) {
+      return;
+    }
+    if (m_blocks[m_active].fill + sizeof(TraceRecord) > kBlockSize && !submit()) {
+      m_num_dropped += 1;
+      return;
+    }
+    Block& block = m_blocks[m_active];
+    if (block.fill == block.start) {
+      m_first_staged_msec = now_msec;
+    }
+    TraceRecord record;
+    record.msec = now_msec;
+    record.type = type;
+    record.arg = arg;
+    record.seq = m_seq++;
+    memcpy(record.text, payload, sizeof(record.text));
+    memcpy(block.data + block.fill, &record, sizeof(record));
+    block.fill += sizeof(record);
+  }
+
+  // Hand the staging block to the writer and start the next one.
+  // Returns false if the writer is still busy with the previous block.
+  bool submit() {
+    if (m_writing.exchange(true)) {
+      return false;
+    }
+    m_flush_requested = false;
+    Block& block = m_blocks[m_active];
+    m_writing_idx = m_active;
+    m_file_used += block.fill - block.start;
+    m_active ^= 1;
+    startBlock(m_blocks[m_active], block.fill % kBlockSize);
+#ifndef NATIVE
+    xTaskNotifyGive(m_task);
+#else
+    writeBlock(block);
+    m_writing.store(false);
+#endif
+    return true;
+  }
+
+  // Prepare the next staging block, which continues the file at offset start (mod kBlockSize).
+  void startBlock(Block& block, size_t start) {
+    block.start = start;
+    block.fill = start;
+    block.new_file = false;
+    if (start == 0 && (m_file_used == 0 || m_file_used + kBlockSize > m_options.file_bytes)) {
+      block.new_file = m_file_used > 0;  // an empty trace0.bin just needs its header
+      m_file_used = 0;
+      TraceFileHeader header = {{'D', 'T', 'R', 'C'}, kVersion, sizeof(TraceRecord), kBlockSize};
+      memcpy(block.data, &header, sizeof(header));
+      block.fill = sizeof(header);
+    }
+  }
+
+#ifndef NATIVE
+  static void flushTask(void* arg) {
+    auto* self = static_cast<TraceLog*>(arg);
+    while (true) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      self->writeBlock(self->m_blocks[self->m_writing_idx]);
+      self->m_writing.store(false);
+    }
+  }
+#endif
+
+  void writeBlock(const Block& block) {
+    if (block.new_file) {
+      rotate();
+    }
+    char path[48];
+    filePath(0, path, sizeof(path));
+    const size_t len = block.fill - block.start;
+    if (len == 0) {
+      return;
+    }
+#ifndef NATIVE
+    File file = LittleFS.open(path, "a");
+    const size_t written = file ? file.write(block.data + block.start, len) : 0;
+    if (file) {
+      file.close();
+    }
+#else
+    FILE* file = fopen(path, "ab");
+    const size_t written = file ? fwrite(block.data + block.start, 1, len, file) : 0;
+    if (file) {
+      fclose(file);
+    }
+#endif
+    m_num_writes += 1;
+    m_bytes_written += written;
+    if (written != len) {
+      m_num_write_errors += 1;
+    }
+  }
+
+  // Drop the oldest file and shift the others along, so trace0.bin is free for a new file.
+  void rotate() {
+    char from[48];
+    char to[48];
+    filePath(m_options.num_files - 1, to, sizeof(to));
+    removeFile(to);
+    for (unsigned idx = m_options.num_files - 1; idx > 0; idx--) {
+      filePath(idx - 1, from, sizeof(from));
+      filePath(idx, to, sizeof(to));
+      renameFile(from, to);
+    }
+  }
+
+#ifndef NATIVE
+  bool makeDir() { return LittleFS.exists(m_options.dir) || LittleFS.mkdir(m_options.dir); }
+  static void removeFile(const char* path) {
+    if (LittleFS.exists(path)) {
+      LittleFS.remove(path);
+    }
+  }
+  static void renameFile(const char* from, const char* to) {
+    if (LittleFS.exists(from)) {
+      LittleFS.rename(from, to);
+    }
+  }
+#else
+  bool makeDir() {
+    struct stat st;
+    return 0 == stat(m_options.dir, &st) || 0 == mkdir(m_options.dir, 0755);
+  }
+  static void removeFile(const char* path) { remove(path); }
+  static void renameFile(const char* from, const char* to) { rename(from, to); }
+#endif
+
+  Options m_options;
+  Block m_blocks[2];
+  unsigned m_active = 0;       // index of the staging block
+  unsigned m_writing_idx = 0;  // index of the block being written
+  std::atomic<bool> m_writing{false};
+  bool m_started = false;
+  bool m_flush_requested = false;
+  size_t m_file_used = 0;  // bytes of trace0.bin written or handed to the writer
+  unsigned long m_first_staged_msec = 0;
+  uint16_t m_seq = 0;
+  uint32_t m_num_dropped = 0;
+  uint32_t m_num_writes = 0;
+  uint32_t m_num_write_errors = 0;
+  uint32_t m_bytes_written = 0;
+#ifndef NATIVE
+  TaskHandle_t m_task = nullptr;
+#endif
+};
+
+}  // namespace og3
@@ -0,0 +1,152 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+// Embeds the built web interface (dist/) into a C++ header for the firmware.
+//
+// Each file is stored gzipped, plus brotli-compressed when that is smaller, and described by
+//  an og3::StaticAsset (see src/static_assets.h).  Files under assets/ carry Vite's content
+//  hash in their names, so they are marked immutable and browsers cache them without
+//  revalidating.  A report of the flash used by each file is printed and written to
+//  dist/flash-report.txt.
+//
+// Usage: node embed-assets.mjs <dist dir> <output header> [--no-brotli]
+
+import { createHash } from 'node:crypto'
+import { readdirSync, readFileSync, statSync, writeFileSync } from 'node:fs'
+import { join, relative, sep } from 'node:path'
+import { brotliCompressSync, constants, gzipSync } from 'node:zlib'
+
+const kReportName = 'flash-report.txt'
+const kContentTypes = {
+  '.css': 'text/css',
+  '.html': 'text/html',
+  '.ico': 'image/x-icon',
+  '.js': 'text/javascript',
+  '.json': 'application/json',
+  '.png': 'image/png',
+  '.svg': 'image/svg+xml',
+  '.txt': 'text/plain',
+  '.webmanifest': 'application/manifest+json',
+  '.woff2': 'font/woff2',
+}
+
+const args = process.argv.slice(2).filter((arg) => !arg.startsWith('--'))
+const useBrotli = !process.argv.includes('--no-brotli')
+if (args.length !== 2) {
+  console.error('usage: node embed-assets.mjs <dist dir> <output header> [--no-brotli]')
+  process.exit(2)
+}
+const [distDir, outPath] = args
+
+function listFiles(dir) {
+  return readdirSync(dir)
+    .sort()
+    .flatMap((name) => {
+      const path = join(dir, name)
+      return statSync(path).isDirectory() ? listFiles(path) : [path]
+    })
+}
+
+function contentType(path) {
+  const dot = path.lastIndexOf('.')
+  return kContentTypes[dot < 0 ? '' : path.slice(dot)] ?? 'application/octet-stream'
+}
+
+function byteArray(name, bytes) {
+  const lines = []
+  for (let idx = 0; idx < bytes.length; idx += 16) {
+    const row = [...bytes.subarray(idx, idx + 16)]
+    lines.push(`    ${row.map((b) => `0x${b.toString(16).padStart(2, '0')}`).join(', ')},`)
+  }
+  return `static const uint8_t ${name}[] PROGMEM = {\n${lines.join('\n')}\n};\n`
+}
+
+const assets = listFiles(distDir)
+  .filter((path) => relative(distDir, path) !== kReportName)
+  .map((path, idx) => {
+    const data = readFileSync(path)
+    const urlPath = '/' + relative(distDir, path).split(sep).join('/')
+    const gzip = gzipSync(data, { level: 9 })
+    const brotli = useBrotli
+      ? brotliCompressSync(data, {
+          params: {
+            [constants.BROTLI_PARAM_QUALITY]: constants.BROTLI_MAX_QUALITY,
+            [constants.BROTLI_PARAM_SIZE_HINT]: data.length,
+          },
+        })
+      : null
+    return {
+      name: `kAsset${idx}`,
+      urlPath,
+      type: contentType(path),
+      size: data.length,
+      gzip,
+      brotli: brotli && brotli.length < gzip.length ? brotli : null,
+      etag: createHash('sha256').update(data).digest('hex').slice(0, 16),
+      immutable: urlPath.startsWith('/assets/'),
+    }
+  })
+
+let out = `// Generated by svelte/embed-assets.mjs from the svelte build: do not edit.
+
+#pragma once
+
+#include <Arduino.h>
+#include <PsychicHttp.h>
+
+#include "static_assets.h"
+
+`
+for (const asset of assets) {
+  out += `// ${asset.urlPath}\n${byteArray(`${asset.name}Gzip`, asset.gzip)}`
+  if (asset.brotli) {
+    out += byteArray(`${asset.name}Brotli`, asset.brotli)
+  }
+  out += '\n'
+}
+out += 'static const og3::StaticAsset kStaticAssets[] = {\n'
+for (const asset of assets) {
+  const brotli = asset.brotli ? `${asset.name}Brotli, sizeof(${asset.name}Brotli)` : 'nullptr, 0'
+  out += `    {"${asset.urlPath}", "${asset.type}",\n`
+  out += `     ${asset.name}Gzip, sizeof(${asset.name}Gzip), ${brotli},\n`
+  out += `     "\\"${asset.etag}\\"", ${asset.immutable}},\n`
+}
+out += `};
+
+inline void initSvelteStaticFiles(PsychicHttpServer* server) {
+  og3::registerStaticAssets(server, kStaticAssets,
+                            sizeof(kStaticAssets) / sizeof(kStaticAssets[0]));
+}
+`
+writeFileSync(outPath, out)
+
+// Flash report: the embedded bytes are the gzip and brotli copies of each file.
+const rows = assets.map((asset) => {
+  const brotliSize = asset.brotli ? asset.brotli.length : 0
+  return [
+    asset.urlPath,
+    asset.size,
+    asset.gzip.length,
+    asset.brotli ? brotliSize : '-',
+    asset.gzip.length + brotliSize,
+    asset.immutable ? 'immutable' : 'no-cache',
+  ]
+})
+const total = (col) => rows.reduce((sum, row) => sum + (Number(row[col]) || 0), 0)
+const flashTotal = total(4)
+rows.push(['total', total(1), total(2), total(3), flashTotal, ''])
+const header = ['file', 'raw', 'gzip', 'brotli', 'flash', 'cache']
+const widths = header.map((title, col) =>
+  Math.max(title.length, ...rows.map((row) => String(row[col]).length)),
+)
+const format = (row) =>
+  row
+    .map((cell, col) =>
+      col === 0 || col === 5 ? String(cell).padEnd(widths[col]) : String(cell).padStart(widths[col]),
+    )
+    .join('  ')
+    .trimEnd()
+const report = [format(header), ...rows.map(format)].join('\n') + '\n'
+writeFileSync(join(distDir, kReportName), report)
+console.log(`Embedded ${assets.length} files in ${outPath}, ${flashTotal} bytes of flash:`)
+console.log(report)
@@ -0,0 +1,135 @@
+// Copyright (c) 2026 Chris Lee and contributors.
+// Licensed under the MIT license. See LICENSE file in the project root for details.
+
+// Host tests for ButtonEvents: pio test -e native
+
+#include <unity.h>
+
+#include <vector>
+
+#include "button_events.h"
+
+using og3::ButtonEvents;
+
+namespace {
+
+constexpr ButtonEvents::Options kOptions = {
+    .pin = 0,
+    .pressed_high = true,
+    .debounce_msec = 50,
+    .long_press_msec = 1000,
+    .double_press_msec = 400,
+};
+
+std::vector<ButtonEvents::Event> pollAll(ButtonEvents* button, unsigned long now_msec) {
+  std::vector<ButtonEvents::Event> events;
+  ButtonEvents::Event event;
+  while (button->poll(now_msec, &event)) {
+    events.push_back(event);
+  }
+  return events;
+}
+
+}  // namespace
+
+void setUp() {}
+void tearDown() {}
+
+// Edges polled as they arrive.
+void test_press_polled_live() {
+  ButtonEvents button(kOptions);
+  button.begin(false);
+  button.addEdge(true, 100);
+  TEST_ASSERT_EQUAL(0, pollAll(&button, 200).size());
+  button.addEdge(false, 250);
+  TEST_ASSERT_EQUAL(0, pollAll(&button, 400).size());
+  const auto events = pollAll(&button, 1000);
+  TEST_ASSERT_EQUAL(1, events.size());
+  TEST_ASSERT_EQUAL(ButtonEvents::kPress, events[0]);
+}
+
+// A whole press and release queued while the main loop was busy.
+void test_press_queued_before_poll() {
+  ButtonEvents button(kOptions);
+  button.begin(false);
+  button.addEdge(true, 100);
+  button.addEdge(false, 250);
+  const auto events = pollAll(&button, 1000);
+  TEST_ASSERT_EQUAL(1, events.size());
+  TEST_ASSERT_EQUAL(ButtonEvents::kPress, events[0]);
+  TEST_ASSERT_FALSE(button.pressed());
+}
+
+// Bounces shorter than debounce_msec are ignored, even when queued together.
+void test_bounces_queued() {
+  ButtonEvents button(kOptions);
+  button.begin(false);
+  button.addEdge(true, 100);
+  button.addEdge(false, 110);
+  button.addEdge(true, 120);
+  button.addEdge(false, 300);
+  button.addEdge(true, 310);
+  button.addEdge(false, 320);
+  const auto events = pollAll(&button, 1000);
+  TEST_ASSERT_EQUAL(1, events.size());
+  TEST_ASSERT_EQUAL(ButtonEvents::kPress, events[0]);
+}
+
+void test_double_press_queued() {
+  ButtonEvents button(kOptions);
+  button.begin(false);
+  button.addEdge(true, 100);
+  button.addEdge(false, 200);
+  button.addEdge(true, 300);
+  button.addEdge(false, 400);
+  const auto events = pollAll(&button, 1500);
+  TEST_ASSERT_EQUAL(1, events.size());
+  TEST_ASSERT_EQUAL(ButtonEvents::kDoublePress, events[0]);
+}
+
+// Two presses further apart than double_press_msec, both queued.
+void test_two_presses_queued() {
+  ButtonEvents button(kOptions);
+  button.begin(false);
+  button.addEdge(true, 100);
+  button.addEdge(false, 200);
+  button.addEdge(true, 800);
+  button.addEdge(false, 900);
+  const auto events = pollAll(&button, 2000);
+  TEST_ASSERT_EQUAL(2, events.size());
+  TEST_ASSERT_EQUAL(ButtonEvents::kPress, events[0]);
+  TEST_ASSERT_EQUAL(ButtonEvents::kPress, events[1]);
+}
+
+void test_long_press_queued() {
+  ButtonEvents button(kOptions);
+  button.begin(false);
+  button.addEdge(true, 100);
+  button.addEdge(false, 1500);
+  const auto events = pollAll(&button, 3000);
+  TEST_ASSERT_EQUAL(1, events.size());
+  TEST_ASSERT_EQUAL(ButtonEvents::kLongPress, events[0]);
+}
+
+void test_long_press_held() {
+  ButtonEvents button(kOptions);
+  button.begin(false);
+  button.addEdge(true, 100);
+  TEST_ASSERT_EQUAL(0, pollAll(&button, 1000).size());
+  const auto events = pollAll(&button, 1100);
+  TEST_ASSERT_EQUAL(1, events.size());
+  TEST_ASSERT_EQUAL(ButtonEvents::kLongPress, events[0]);
+  TEST_ASSERT_TRUE(button.pressed());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_press_polled_live);
+  RUN_TEST(test_press_queued_before_poll);
+  RUN_TEST(test_bounces_queued);
+  RUN_TEST(test_double_press_queued);
+  RUN_TEST(test_two_presses_queued);
+  RUN_TEST(test_long_press_queued);
+  RUN_TEST(test_long_press_held);
+  return UNITY_END();
+}